@@ -0,0 +1,877 @@
+// apc_bench: drives APCMiniController through a VirtualApcMini and prints the results as JSON.
+// Usage: apc_bench [--quick]
+
+#include "apc_mini_controller.hpp"
+#include "apc_mini_layout.hpp"
+#include "bitboard_patterns.hpp"
+#include "builtin_patterns.hpp"
+#include "capture_replayer.hpp"
+#include "clip.hpp"
+#ifdef APC_MINI_COROUTINES
+#include "cue_executor.hpp"
+#endif
+#include "event_capture.hpp"
+#include "handler_table.hpp"
+#include "led_scheduler.hpp"
+#include "light_pattern_controller.hpp"
+#include "midi_clock.hpp"
+#include "shared_event_bus.hpp"
+#include "thread_policy.hpp"
+#include "virtual_apc_mini.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Counts every allocation in the process, so the real-time benchmark can show there are none
+std::atomic<std::uint64_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size ? size : 1))
+    return memory;
+  throw std::bad_alloc();
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  auto align = static_cast<std::size_t>(alignment);
+  // aligned_alloc wants a multiple of the alignment
+  if (void *memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align))
+    return memory;
+  throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Swallows the controller's std::cout/std::cerr logging so only the JSON report reaches the terminal
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+std::int64_t nowNs() { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); }
+
+double secondsSince(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+struct Percentiles {
+  double p50 = 0;
+  double p99 = 0;
+  double p999 = 0;
+  double max = 0;
+};
+
+Percentiles percentiles(std::vector<double> &samples) {
+  Percentiles result;
+  if (samples.empty())
+    return result;
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double q) { return samples[static_cast<std::size_t>(q * static_cast<double>(samples.size() - 1))]; };
+  result.p50 = at(0.50);
+  result.p99 = at(0.99);
+  result.p999 = at(0.999);
+  result.max = samples.back();
+  return result;
+}
+
+// Controller wired to an in-memory device
+struct VirtualRig {
+  VirtualApcMini *device = nullptr;
+  std::unique_ptr<APCMiniController> controller;
+
+  VirtualRig() {
+    auto transport = std::make_unique<VirtualApcMini>();
+    device = transport.get();
+    controller = std::make_unique<APCMiniController>(std::move(transport));
+    controller->connect();
+  }
+};
+
+bool waitFor(const std::atomic<std::uint64_t> &counter, std::uint64_t target, std::chrono::milliseconds timeout) {
+  auto deadline = Clock::now() + timeout;
+  while (counter.load(std::memory_order_acquire) < target) {
+    if (Clock::now() > deadline)
+      return false;
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+// Input callback -> user ButtonCallback, one event in flight at a time
+void benchInputLatency(std::size_t iterations, bool &first) {
+  VirtualRig rig;
+  std::atomic<std::uint64_t> delivered{0};
+  std::atomic<std::int64_t> deliveredAt{0};
+  rig.controller->setButtonCallback([&](APCMiniController::ButtonType, int, bool) {
+    deliveredAt.store(nowNs(), std::memory_order_relaxed);
+    delivered.fetch_add(1, std::memory_order_release);
+  });
+
+  std::vector<double> latencies;
+  latencies.reserve(iterations);
+  for (std::size_t i = 0; i < iterations; i++) {
+    int note = static_cast<int>(i % 64);
+    std::int64_t start = nowNs();
+    if (i % 2 == 0)
+      rig.device->pressButton(note);
+    else
+      rig.device->releaseButton(note);
+    if (!waitFor(delivered, i + 1, std::chrono::milliseconds(1000)))
+      break;
+    latencies.push_back(static_cast<double>(deliveredAt.load(std::memory_order_relaxed) - start) / 1000.0);
+  }
+  std::size_t samples = latencies.size();
+  Percentiles p = percentiles(latencies);
+  // The controller's own histogram, bucketed to powers of two
+  auto stats = rig.controller->getStats();
+
+  std::printf("%s\n    \"input_latency\": {\"samples\": %zu, \"unit\": \"us\", \"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f, "
+              "\"controller_p50_upper\": %.3f, \"controller_p99_upper\": %.3f, \"callback_mean\": %.3f}",
+              first ? "" : ",", samples, p.p50, p.p99, p.p999, p.max, static_cast<double>(stats.inputLatency.percentileNs(0.50)) / 1000.0,
+              static_cast<double>(stats.inputLatency.percentileNs(0.99)) / 1000.0, stats.callbackTime.meanNs() / 1000.0);
+  first = false;
+}
+
+// POLLING mode: the same press/release, picked up by poll() on the injecting thread with no
+// dispatch or LED thread involved, plus the LED echo flushed from that thread
+void benchPollingLatency(std::size_t iterations, bool &first) {
+  auto transport = std::make_unique<VirtualApcMini>();
+  VirtualApcMini *device = transport.get();
+  APCMiniController controller(std::move(transport));
+  controller.connect(APCMiniController::DispatchMode::POLLING);
+
+  std::array<APCMiniController::ControllerEvent, 64> events;
+  std::vector<double> latencies;
+  latencies.reserve(iterations);
+  std::size_t polled = 0;
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < iterations; i++) {
+    int note = static_cast<int>(i % 64);
+    std::int64_t begin = nowNs();
+    if (i % 2 == 0)
+      device->pressButton(note);
+    else
+      device->releaseButton(note);
+    std::size_t count = controller.poll(events);
+    for (std::size_t e = 0; e < count; e++) {
+      controller.setGridLED(ApcMiniLayout::gridIndex(events[e].number),
+                            events[e].isPressed() ? APCMiniController::LedColor::GREEN : APCMiniController::LedColor::OFF);
+    }
+    controller.flushLEDs();
+    latencies.push_back(static_cast<double>(nowNs() - begin) / 1000.0);
+    polled += count;
+  }
+  double seconds = secondsSince(start);
+  bool echoed = device->ledState(ApcMiniLayout::gridNote(static_cast<int>((iterations - 1) % 64))) == ((iterations - 1) % 2 == 0 ? 1 : 0);
+  controller.disconnect();
+  Percentiles p = percentiles(latencies);
+
+  std::printf("%s\n    \"polling_latency\": {\"samples\": %zu, \"polled\": %zu, \"unit\": \"us\", \"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, "
+              "\"max\": %.3f, \"ticks_per_second\": %.0f, \"led_echoed\": %s}",
+              first ? "" : ",", latencies.size(), polled, p.p50, p.p99, p.p999, p.max, static_cast<double>(iterations) / seconds,
+              echoed ? "true" : "false");
+  first = false;
+}
+
+void injectMixed(VirtualApcMini &device, std::size_t i) {
+  if (i % 4 == 0)
+    device.moveFader(48 + static_cast<int>(i % 9), static_cast<int>(i % 128));
+  else if (i % 2 == 0)
+    device.pressButton(static_cast<int>(i % 64));
+  else
+    device.releaseButton(static_cast<int>(i % 64));
+}
+
+// midiCallback -> processCallback -> handleMidiMessage. "sustained" keeps at most half a queue
+// in flight so nothing is dropped; "burst" injects flat out and reports what the queue lost.
+void benchInputThroughput(std::size_t events, bool &first) {
+  const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+  const char *modes[] = {"sustained", "burst"};
+
+  std::printf("%s\n    \"input_throughput\": {\"queue_capacity\": %zu", first ? "" : ",", APCMiniController::EVENT_QUEUE_CAPACITY);
+  first = false;
+  for (int mode = 0; mode < 2; mode++) {
+    VirtualRig rig;
+    std::atomic<std::uint64_t> delivered{0};
+    rig.controller->setButtonCallback([&](APCMiniController::ButtonType, int, bool) { delivered.fetch_add(1, std::memory_order_release); });
+    rig.controller->setFaderCallback([&](APCMiniController::Fader, int) { delivered.fetch_add(1, std::memory_order_release); });
+
+    auto start = Clock::now();
+    for (std::size_t i = 0; i < events; i++) {
+      if (mode == 0) {
+        while (i - delivered.load(std::memory_order_acquire) >= window) {
+          std::this_thread::yield();
+        }
+      }
+      injectMixed(*rig.device, i);
+    }
+
+    // Everything not dropped must eventually be delivered
+    auto deadline = Clock::now() + std::chrono::seconds(10);
+    while (delivered.load(std::memory_order_acquire) + rig.controller->droppedEventCount() < events && Clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+    double seconds = secondsSince(start);
+    auto deliveredCount = delivered.load();
+
+    std::printf(", \"%s\": {\"events\": %zu, \"delivered\": %llu, \"dropped\": %zu, \"seconds\": %.6f, \"events_per_second\": %.0f}",
+                modes[mode], events, static_cast<unsigned long long>(deliveredCount), rig.controller->droppedEventCount(), seconds,
+                static_cast<double>(deliveredCount) / seconds);
+  }
+  std::printf("}");
+}
+
+// Steady-state output messages and CPU cost per frame for every built-in pattern
+void benchPatterns(std::size_t frames, bool &first) {
+  std::printf("%s\n    \"patterns\": [", first ? "" : ",");
+  first = false;
+
+  bool firstPattern = true;
+  for (int id : LightPatternController::patternIds()) {
+    VirtualRig rig;
+    LightPatternController patterns(*rig.controller, false);
+    patterns.startPattern(id);
+    patterns.renderFrame(); // The first frame pays for the unknown device state
+    rig.controller->flushLEDs();
+    rig.device->resetCounters();
+    rig.controller->resetStats();
+
+    // Flushing on this thread keeps one frame per write instead of racing the output thread
+    std::clock_t cpuStart = std::clock();
+    auto wallStart = Clock::now();
+    for (std::size_t i = 0; i < frames; i++) {
+      patterns.renderFrame();
+      rig.controller->flushLEDs();
+    }
+    double wallSeconds = secondsSince(wallStart);
+    double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    double perFrame = static_cast<double>(frames);
+    auto stats = rig.controller->getStats();
+
+    std::printf("%s\n      {\"pattern\": %d, \"frames\": %zu, \"messages_per_frame\": %.2f, \"bytes_per_frame\": %.2f, "
+                "\"writes_per_frame\": %.2f, \"wall_us_per_frame\": %.3f, \"cpu_us_per_frame\": %.3f}",
+                firstPattern ? "" : ",", id, frames, static_cast<double>(rig.device->sentMessageCount()) / perFrame,
+                static_cast<double>(rig.device->sentByteCount()) / perFrame, static_cast<double>(stats.writeBatches) / perFrame,
+                wallSeconds * 1e6 / perFrame, cpuSeconds * 1e6 / perFrame);
+    firstPattern = false;
+  }
+  std::printf("\n    ]");
+}
+
+// Records the Color Wave pattern into a clip (with the round LEDs counting along), then plays
+// the clip from its mapping. Compare with the computed pattern 66 above.
+void benchClip(std::size_t frames, bool &first) {
+  const int clipFrames = 48;
+  auto path = (std::filesystem::temp_directory_path() / "apc_bench.clip").string();
+  {
+    ClipWriter writer;
+    auto source = makeBuiltinPattern(66);
+    std::mt19937 rng(1);
+    GridFrame grid;
+    source->reset();
+    for (int i = 0; i < clipFrames; i++) {
+      FrameContext context{static_cast<std::uint64_t>(i), rng};
+      source->render(grid, context);
+      ClipWriter::RoundState round{};
+      round[static_cast<std::size_t>(i % GridFrame::ROUND_COUNT)] = 1;
+      writer.addFrame(grid, std::chrono::milliseconds(50), round);
+    }
+    writer.save(path);
+  }
+  auto fileBytes = std::filesystem::file_size(path);
+
+  VirtualRig rig;
+  LightPatternController patterns(*rig.controller, false);
+  patterns.registerClip(1000, path);
+  auto openStart = Clock::now();
+  patterns.startPattern(1000);
+  double openSeconds = secondsSince(openStart);
+  patterns.renderFrame();
+  rig.controller->flushLEDs();
+  rig.device->resetCounters();
+
+  std::clock_t cpuStart = std::clock();
+  auto wallStart = Clock::now();
+  for (std::size_t i = 0; i < frames; i++) {
+    patterns.renderFrame();
+    rig.controller->flushLEDs();
+  }
+  double wallSeconds = secondsSince(wallStart);
+  double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  double perFrame = static_cast<double>(frames);
+  std::filesystem::remove(path);
+
+  std::printf("%s\n    \"clip\": {\"clip_frames\": %d, \"file_bytes\": %llu, \"open_us\": %.3f, \"frames\": %zu, \"messages_per_frame\": %.2f, "
+              "\"bytes_per_frame\": %.2f, \"wall_us_per_frame\": %.3f, \"cpu_us_per_frame\": %.3f}",
+              first ? "" : ",", clipFrames, static_cast<unsigned long long>(fileBytes), openSeconds * 1e6, frames,
+              static_cast<double>(rig.device->sentMessageCount()) / perFrame, static_cast<double>(rig.device->sentByteCount()) / perFrame,
+              wallSeconds * 1e6 / perFrame, cpuSeconds * 1e6 / perFrame);
+  first = false;
+}
+
+// Game of Life generations as one bitboard step against the same rule cell by cell, and the
+// render cost of the marquee and the bitboard color wave on a four device canvas
+void benchBitboard(std::size_t generations, std::size_t frames, bool &first) {
+  std::mt19937_64 rng(1);
+  std::uint64_t board = rng();
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < generations; i++) {
+    board = Bitboard::lifeStep(board);
+    if (board == 0)
+      board = rng();
+  }
+  double bitboardNs = secondsSince(start) * 1e9 / static_cast<double>(generations);
+
+  std::array<std::array<bool, 8>, 8> cells{};
+  for (int index = 0; index < GridFrame::SIZE; index++) {
+    cells[static_cast<std::size_t>(index / 8)][static_cast<std::size_t>(index % 8)] = (board >> index) & 1;
+  }
+  int cellwiseLive = 0;
+  start = Clock::now();
+  for (std::size_t i = 0; i < generations; i++) {
+    std::array<std::array<bool, 8>, 8> next{};
+    cellwiseLive = 0;
+    for (int row = 0; row < 8; row++) {
+      for (int col = 0; col < 8; col++) {
+        int neighbours = 0;
+        for (int dr = 7; dr <= 9; dr++) {
+          for (int dc = 7; dc <= 9; dc++) {
+            if (dr != 8 || dc != 8)
+              neighbours += cells[static_cast<std::size_t>((row + dr) % 8)][static_cast<std::size_t>((col + dc) % 8)];
+          }
+        }
+        bool live = neighbours == 3 || (neighbours == 2 && cells[static_cast<std::size_t>(row)][static_cast<std::size_t>(col)]);
+        next[static_cast<std::size_t>(row)][static_cast<std::size_t>(col)] = live;
+        cellwiseLive += live;
+      }
+    }
+    cells = next;
+    if (cellwiseLive == 0)
+      cells[3][3] = cells[3][4] = cells[3][5] = true;
+  }
+  double cellwiseNs = secondsSince(start) * 1e9 / static_cast<double>(generations);
+
+  auto frameNs = [frames](Pattern &pattern) {
+    GridFrame canvas(GridFrame::MAX_TILES);
+    std::mt19937 patternRng(1);
+    pattern.reset();
+    auto renderStart = Clock::now();
+    for (std::size_t i = 0; i < frames; i++) {
+      FrameContext context{i, patternRng};
+      pattern.render(canvas, context);
+    }
+    return secondsSince(renderStart) * 1e9 / static_cast<double>(frames);
+  };
+  MarqueePattern marquee("Tempo 128.0 bpm - Scene 4");
+  auto wave = makeBuiltinPattern(66);
+
+  std::printf("%s\n    \"bitboard\": {\"generations\": %zu, \"life_step_ns\": %.2f, \"life_cellwise_ns\": %.2f, \"live_cells\": %d, "
+              "\"cellwise_live_cells\": %d, \"frames\": %zu, \"marquee_frame_ns\": %.1f, \"color_wave_frame_ns\": %.1f}",
+              first ? "" : ",", generations, bitboardNs, cellwiseNs, Bitboard::count(board), cellwiseLive, frames, frameNs(marquee),
+              frameNs(*wave));
+  first = false;
+}
+
+// Cost of a single setGridLED call, with and without a state change. Calls only publish to the
+// output thread; "messages" is what reached the device after coalescing.
+void benchGridLED(std::size_t calls, bool &first) {
+  VirtualRig rig;
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < calls; i++) {
+    auto color = (i / 64) % 2 ? APCMiniController::LedColor::GREEN : APCMiniController::LedColor::RED;
+    rig.controller->setGridLED(static_cast<int>(i % 64), color);
+  }
+  double changedSeconds = secondsSince(start);
+  rig.controller->flushLEDs();
+  auto messages = rig.device->sentMessageCount();
+
+  start = Clock::now();
+  for (std::size_t i = 0; i < calls; i++) {
+    rig.controller->setGridLED(static_cast<int>(i % 64), APCMiniController::LedColor::RED);
+  }
+  double unchangedSeconds = secondsSince(start);
+  auto n = static_cast<double>(calls);
+
+  std::printf("%s\n    \"set_grid_led\": {\"calls\": %zu, \"messages\": %llu, \"ns_per_call_changed\": %.1f, \"ns_per_call_unchanged\": %.1f}",
+              first ? "" : ",", calls, static_cast<unsigned long long>(messages), changedSeconds * 1e9 / n, unchangedSeconds * 1e9 / n);
+  first = false;
+}
+
+// Nine faders swept up and down with +-1 pot jitter, through each FaderStage mode. Reports how
+// many callbacks the sweep costs and whether every fader ends on its final value.
+void benchFaderStage(std::size_t steps, bool &first) {
+  struct Mode {
+    const char *name;
+    FaderStage::Config config;
+  };
+  const Mode modes[] = {
+      {"immediate", {FaderStage::Delivery::IMMEDIATE, std::chrono::microseconds(0), 0}},
+      {"immediate_hysteresis", {FaderStage::Delivery::IMMEDIATE, std::chrono::microseconds(0), 1}},
+      {"per_batch", {FaderStage::Delivery::PER_BATCH, std::chrono::microseconds(0), 1}},
+      {"max_rate_10ms", {FaderStage::Delivery::MAX_RATE, std::chrono::microseconds(10000), 1}},
+  };
+  const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+
+  std::printf("%s\n    \"fader_stage\": {\"faders\": %d, \"steps\": %zu", first ? "" : ",", FaderStage::FADER_COUNT, steps);
+  first = false;
+  for (const auto &mode : modes) {
+    auto transport = std::make_unique<VirtualApcMini>();
+    VirtualApcMini *device = transport.get();
+    APCMiniController controller(std::move(transport));
+    controller.setFaderStage(mode.config);
+    std::atomic<int> lastValue[FaderStage::FADER_COUNT] = {};
+    controller.setFaderCallback([&](APCMiniController::Fader fader, int value) {
+      lastValue[static_cast<int>(fader) - FaderStage::FIRST_CONTROL].store(value, std::memory_order_relaxed);
+    });
+    controller.connect();
+
+    auto start = Clock::now();
+    std::size_t injected = 0;
+    for (std::size_t step = 0; step <= steps; step++) {
+      // Triangle sweep ending at 0, with the jitter a worn pot adds on top
+      int sweep = static_cast<int>((step * 254 / steps) % 254);
+      int base = sweep > 127 ? 254 - sweep : sweep;
+      for (int fader = 0; fader < FaderStage::FADER_COUNT; fader++) {
+        int jitter = step == steps ? 0 : static_cast<int>((step + static_cast<std::size_t>(fader)) % 3) - 1;
+        int value = std::min(127, std::max(0, base + jitter));
+        while (injected - controller.getStats().eventsReceived >= window) {
+          std::this_thread::yield();
+        }
+        device->moveFader(FaderStage::FIRST_CONTROL + fader, value);
+        injected++;
+      }
+    }
+    while (controller.getStats().eventsReceived < injected) {
+      std::this_thread::yield();
+    }
+    double seconds = secondsSince(start);
+    // Let held values fall due
+    std::this_thread::sleep_for(mode.config.minInterval * 2 + std::chrono::milliseconds(5));
+
+    auto stats = controller.getStats();
+    bool settled = true;
+    for (auto &value : lastValue) {
+      settled = settled && value.load() == 0;
+    }
+    std::printf(", \"%s\": {\"updates\": %llu, \"deliveries\": %llu, \"delivery_ratio\": %.4f, \"settled\": %s, \"seconds\": %.6f}",
+                mode.name, static_cast<unsigned long long>(stats.faderUpdates), static_cast<unsigned long long>(stats.faderDeliveries),
+                stats.faderUpdates ? static_cast<double>(stats.faderDeliveries) / static_cast<double>(stats.faderUpdates) : 0.0,
+                settled ? "true" : "false", seconds);
+  }
+  std::printf("}");
+}
+
+// One std::function branching on the button type, as main.cpp used to, against a HandlerTable
+// resolving the same handlers per note
+void benchHandlerDispatch(std::size_t calls, bool &first) {
+  static constexpr int NOTES[] = {0, 64, 82, 98, 37, 70, 85, 63};
+  std::uint64_t horizontal = 0, vertical = 0, other = 0;
+
+  APCMiniController::ButtonCallback callback = [&](APCMiniController::ButtonType type, int note, bool isPressed) {
+    if (type == APCMiniController::ButtonType::HORIZONTAL) {
+      horizontal += static_cast<std::uint64_t>(note) + isPressed;
+    } else if (type == APCMiniController::ButtonType::VERTICAL) {
+      vertical += static_cast<std::uint64_t>(note) + isPressed;
+    } else {
+      other += static_cast<std::uint64_t>(note) + isPressed;
+    }
+  };
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < calls; i++) {
+    int note = NOTES[i % 8];
+    callback(ApcMiniLayout::noteInfo(note).type, note, (i & 8) != 0);
+  }
+  double functionSeconds = secondsSince(start);
+  auto functionSum = horizontal + vertical + other;
+
+  horizontal = vertical = other = 0;
+  HandlerTable table;
+  table.onButtonType(APCMiniController::ButtonType::HORIZONTAL, [&horizontal](int note, bool isPressed) { horizontal += static_cast<std::uint64_t>(note) + isPressed; })
+      .onButtonType(APCMiniController::ButtonType::VERTICAL, [&vertical](int note, bool isPressed) { vertical += static_cast<std::uint64_t>(note) + isPressed; })
+      .onButtonType(APCMiniController::ButtonType::GRID, [&other](int note, bool isPressed) { other += static_cast<std::uint64_t>(note) + isPressed; })
+      .onButtonType(APCMiniController::ButtonType::SPECIAL, [&other](int note, bool isPressed) { other += static_cast<std::uint64_t>(note) + isPressed; });
+  start = Clock::now();
+  for (std::size_t i = 0; i < calls; i++) {
+    table.dispatchButton(NOTES[i % 8], (i & 8) != 0);
+  }
+  double tableSeconds = secondsSince(start);
+
+  std::printf("%s\n    \"handler_dispatch\": {\"calls\": %zu, \"function_ns_per_call\": %.2f, \"table_ns_per_call\": %.2f, \"same_result\": %s}",
+              first ? "" : ",", calls, functionSeconds * 1e9 / static_cast<double>(calls), tableSeconds * 1e9 / static_cast<double>(calls),
+              functionSum == horizontal + vertical + other ? "true" : "false");
+  first = false;
+}
+
+#ifdef APC_MINI_COROUTINES
+Cue pressCounter(CueExecutor &executor, int note, std::atomic<std::uint64_t> &resumes) {
+  for (;;) {
+    co_await executor.nextPress(note);
+    resumes.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Thousands of cues waiting on grid buttons, all on the controller's one dispatch thread
+void benchCues(std::size_t cueCount, std::size_t rounds, bool &first) {
+  VirtualRig rig;
+  std::atomic<std::uint64_t> resumes{0};
+  auto executor = std::make_unique<CueExecutor>(*rig.controller);
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < cueCount; i++) {
+    executor->spawn(pressCounter(*executor, static_cast<int>(i % 64), resumes));
+  }
+  rig.controller->wake();
+  while (rig.controller->hasPendingEvents()) {
+    std::this_thread::yield();
+  }
+  double spawnSeconds = secondsSince(start);
+
+  start = Clock::now();
+  for (std::size_t round = 0; round < rounds; round++) {
+    for (int note = 0; note < 64; note++) {
+      rig.device->pressButton(note);
+      rig.device->releaseButton(note);
+    }
+    waitFor(resumes, (round + 1) * cueCount, std::chrono::milliseconds(5000));
+  }
+  double seconds = secondsSince(start);
+  rig.controller->disconnect();
+  executor.reset();
+
+  std::printf("%s\n    \"cues\": {\"cues\": %zu, \"rounds\": %zu, \"resumes\": %llu, \"spawn_seconds\": %.6f, \"resumes_per_second\": %.0f}",
+              first ? "" : ",", cueCount, rounds, static_cast<unsigned long long>(resumes.load()), spawnSeconds,
+              static_cast<double>(resumes.load()) / seconds);
+  first = false;
+}
+#endif
+
+// LED changes scheduled 2 ms apart (a few sharing a deadline) while input floods the
+// dispatch thread; lateness is deadline to batch written. withPattern adds an animation
+// thread holding its own LED frames at 100 fps, which the scheduled writes must not wait for.
+void benchLedScheduler(std::size_t deadlines, bool withPattern, bool &first) {
+  VirtualRig rig;
+  LedScheduler scheduler(*rig.controller);
+  scheduler.start();
+  std::unique_ptr<LightPatternController> lights;
+  if (withPattern) {
+    lights = std::make_unique<LightPatternController>(*rig.controller);
+    lights->setFrameRate(100);
+    lights->startPattern(64);
+  }
+
+  std::atomic<bool> loading{true};
+  std::thread load([&]() {
+    const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+    for (std::size_t i = 0; loading.load(std::memory_order_relaxed); i++) {
+      while (i - rig.controller->getStats().eventsReceived >= window && loading.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+      injectMixed(*rig.device, i);
+    }
+  });
+
+  auto start = LedScheduler::Clock::now() + std::chrono::milliseconds(10);
+  for (std::size_t i = 0; i < deadlines; i++) {
+    auto when = start + std::chrono::milliseconds(2 * i);
+    for (int led = 0; led < 4; led++) {
+      scheduler.scheduleGridLED(static_cast<int>((i * 4 + static_cast<std::size_t>(led)) % 64),
+                                i % 2 ? APCMiniController::LedColor::OFF : APCMiniController::LedColor::GREEN, when);
+    }
+  }
+  while (scheduler.pendingCount() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  loading = false;
+  load.join();
+  auto stats = scheduler.getStats();
+  scheduler.stop();
+  lights.reset();
+
+  std::printf("%s\n    \"%s\": {\"changes\": %llu, \"failed\": %llu, \"batches\": %llu, \"input_events\": %llu, \"lateness_mean_us\": %.3f, "
+              "\"lateness_p99_upper_us\": %.3f, \"lateness_max_us\": %.3f, \"early_sends\": %llu, \"earliness_max_us\": %.3f}",
+              first ? "" : ",", withPattern ? "led_scheduler_with_pattern" : "led_scheduler", static_cast<unsigned long long>(stats.sent),
+              static_cast<unsigned long long>(stats.failed), static_cast<unsigned long long>(stats.batches),
+              static_cast<unsigned long long>(rig.controller->getStats().eventsReceived), stats.lateness.meanNs() / 1000.0,
+              static_cast<double>(stats.lateness.percentileNs(0.99)) / 1000.0, static_cast<double>(stats.lateness.maxNs) / 1000.0,
+              static_cast<unsigned long long>(stats.earliness.count), static_cast<double>(stats.earliness.maxNs) / 1000.0);
+  first = false;
+}
+
+// Input fanned out through the shared memory bus to a client following it on another thread
+void benchSharedBus(std::size_t events, bool &first) {
+  VirtualRig rig;
+  std::string name = "/apc_bench_" + std::to_string(static_cast<long long>(getpid()));
+  auto bus = SharedEventBus::create(*rig.controller, name, 1 << 16);
+  auto client = bus ? SharedEventBusClient::open(name) : nullptr;
+  if (!client)
+    return;
+
+  std::atomic<std::uint64_t> received{0};
+  std::atomic<bool> reading{true};
+  std::thread reader([&]() {
+    std::array<APCMiniController::ControllerEvent, 256> batch;
+    while (reading.load(std::memory_order_relaxed) || received.load() + client->lostEvents() < events) {
+      auto count = client->read(batch);
+      received.fetch_add(count, std::memory_order_release);
+      if (count == 0)
+        std::this_thread::yield();
+    }
+  });
+
+  const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < events; i++) {
+    while (i - rig.controller->getStats().eventsReceived >= window) {
+      std::this_thread::yield();
+    }
+    injectMixed(*rig.device, i);
+  }
+  while (bus->publishedCount() < events) {
+    std::this_thread::yield();
+  }
+  double seconds = secondsSince(start);
+  reading = false;
+  reader.join();
+  rig.controller->disconnect();
+
+  std::printf("%s\n    \"shared_bus\": {\"events\": %zu, \"published\": %llu, \"client_received\": %llu, \"client_lost\": %llu, "
+              "\"events_per_second\": %.0f}",
+              first ? "" : ",", events, static_cast<unsigned long long>(bus->publishedCount()), static_cast<unsigned long long>(received.load()),
+              static_cast<unsigned long long>(client->lostEvents()), static_cast<double>(events) / seconds);
+  first = false;
+}
+
+// Tempo tracking from 120 bpm clock pulses with +/-1 ms of jitter, against the true beat; then
+// clock interleaved with a burst of input that overruns the event queue, where no pulse may be lost
+void benchMidiClock(std::size_t pulses, std::size_t events, bool &first) {
+  const std::int64_t pulseNs = 500000000 / MidiClock::PULSES_PER_QUARTER;
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<std::int64_t> jitter(-1000000, 1000000);
+  MidiClock clock;
+  std::int64_t startNs = 1000000000;
+  clock.feed(MidiClock::START, startNs);
+  std::size_t lockedAt = 0;
+  double bpm = 0;
+  std::vector<double> phaseErrorsUs;
+  for (std::size_t i = 0; i < pulses; i++) {
+    std::int64_t ideal = startNs + static_cast<std::int64_t>(i) * pulseNs;
+    clock.feed(MidiClock::CLOCK, ideal + jitter(rng));
+    // Sample halfway to the next pulse, where extrapolation matters most
+    auto position = clock.position(ideal + pulseNs / 2);
+    if (!position.locked)
+      continue;
+    if (lockedAt == 0)
+      lockedAt = i + 1;
+    double trueBeats = (static_cast<double>(i) + 0.5) / MidiClock::PULSES_PER_QUARTER;
+    phaseErrorsUs.push_back(std::abs(position.beats - trueBeats) * 500000.0);
+    bpm = position.bpm;
+  }
+  auto phase = percentiles(phaseErrorsUs);
+
+  VirtualRig rig;
+  const unsigned char tick = MidiClock::CLOCK;
+  std::size_t sent = 0;
+  auto start = Clock::now();
+  for (std::size_t i = 0; i < events; i++) {
+    injectMixed(*rig.device, i);
+    if (i % 8 == 0) {
+      rig.device->inject(&tick, 1);
+      sent++;
+    }
+  }
+  double seconds = secondsSince(start);
+  auto stats = rig.controller->getStats();
+
+  std::printf("%s\n    \"midi_clock\": {\"pulses\": %zu, \"locked_after_pulses\": %zu, \"bpm\": %.3f, \"phase_error_p50_us\": %.1f, "
+              "\"phase_error_p99_us\": %.1f, \"phase_error_max_us\": %.1f, \"flood_events\": %zu, \"flood_dropped\": %llu, "
+              "\"flood_pulses_sent\": %zu, \"flood_pulses_seen\": %llu, \"flood_events_per_second\": %.0f}",
+              first ? "" : ",", pulses, lockedAt, bpm, phase.p50, phase.p99, phase.max, events,
+              static_cast<unsigned long long>(stats.eventsDropped), sent, static_cast<unsigned long long>(rig.controller->getMidiClock().pulseCount()),
+              static_cast<double>(events + sent) / seconds);
+  first = false;
+}
+
+// Unplug and replug with every LED lit: time from reopening the port to the full state resent
+void benchReconnect(std::size_t cycles, bool &first) {
+  VirtualRig rig;
+  for (int i = 0; i < 64; i++) {
+    rig.controller->setGridLED(i, APCMiniController::LedColor::YELLOW);
+  }
+  for (int note = 64; note < 72; note++) {
+    rig.controller->setHorizontalLED(static_cast<APCMiniController::HorizontalButton>(note), APCMiniController::RoundLedState::ON);
+  }
+  rig.controller->resetStats();
+
+  bool restored = true;
+  for (std::size_t i = 0; i < cycles; i++) {
+    rig.device->unplug();
+    rig.controller->checkConnection();
+    rig.device->plugIn();
+    rig.controller->checkConnection();
+    restored = restored && rig.device->ledState(56) == static_cast<unsigned char>(APCMiniController::LedColor::YELLOW) &&
+               rig.device->ledState(71) == 1;
+  }
+  auto stats = rig.controller->getStats();
+
+  std::printf("%s\n    \"reconnect\": {\"cycles\": %zu, \"reconnects\": %llu, \"restored\": %s, \"messages_per_restore\": %.1f, "
+              "\"restore_mean_us\": %.3f, \"restore_max_us\": %.3f}",
+              first ? "" : ",", cycles, static_cast<unsigned long long>(stats.reconnects), restored ? "true" : "false",
+              static_cast<double>(stats.messagesSent) / static_cast<double>(cycles), stats.restoreTime.meanNs() / 1000.0,
+              static_cast<double>(stats.restoreTime.maxNs) / 1000.0);
+  first = false;
+}
+
+// Captures a session with LED feedback on every grid press, then replays it into a fresh
+// controller as fast as possible. The LEDs must end up exactly as captured.
+void benchReplay(std::size_t events, bool &first) {
+  auto feedback = [](APCMiniController &controller) {
+    controller.setButtonCallback([&controller](APCMiniController::ButtonType type, int note, bool isPressed) {
+      if (type == APCMiniController::ButtonType::GRID)
+        controller.setGridLED(ApcMiniLayout::gridIndex(note), isPressed ? APCMiniController::LedColor::GREEN : APCMiniController::LedColor::OFF);
+    });
+  };
+
+  EventCapture capture(events * 2 + 256);
+  {
+    VirtualRig rig;
+    feedback(*rig.controller);
+    rig.controller->setCapture(&capture);
+    const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+    for (std::size_t i = 0; i < events; i++) {
+      while (i % 64 == 0 && i - rig.controller->getStats().eventsReceived >= window) {
+        std::this_thread::yield();
+      }
+      injectMixed(*rig.device, i);
+    }
+    while (rig.controller->getStats().eventsReceived < events) {
+      std::this_thread::yield();
+    }
+    rig.controller->flushLEDs();
+    rig.controller->setCapture(nullptr);
+    capture.stop();
+  }
+  auto records = capture.snapshot();
+
+  VirtualRig rig;
+  feedback(*rig.controller);
+  CaptureReplayer replayer(*rig.controller, *rig.device);
+  auto result = replayer.replay(records, CaptureReplayer::Speed::FAST);
+
+  std::printf("%s\n    \"replay\": {\"records\": %zu, \"record_bytes\": %zu, \"inbound\": %zu, \"dispatched\": %zu, \"dropped\": %zu, "
+              "\"seconds\": %.6f, \"events_per_second\": %.0f, \"led_mismatches\": %d}",
+              first ? "" : ",", records.size(), sizeof(EventCapture::Record), result.inbound, result.dispatched, result.dropped, result.seconds,
+              result.eventsPerSecond, result.ledMismatches);
+  first = false;
+}
+
+// Real-time mode: everything pinned to CPU 0 with memory locked, input and fader traffic with
+// LED feedback while two pattern layers animate. No allocation may happen after connect();
+// returns false if one did.
+bool benchRealtime(std::size_t events, bool &first) {
+  auto transport = std::make_unique<VirtualApcMini>();
+  VirtualApcMini *device = transport.get();
+  APCMiniController controller(std::move(transport));
+  ThreadPolicy pinned;
+  pinned.cpu = 0;
+  controller.setRealtime({pinned, pinned, pinned, true});
+  controller.setButtonCallback([&controller](APCMiniController::ButtonType type, int note, bool isPressed) {
+    if (type == APCMiniController::ButtonType::GRID)
+      controller.setGridLED(ApcMiniLayout::gridIndex(note), isPressed ? APCMiniController::LedColor::RED : APCMiniController::LedColor::OFF);
+  });
+  controller.connect();
+  LightPatternController lights(controller);
+  lights.setThreadPolicy(pinned);
+  lights.setFrameRate(100);
+  lights.startPattern(64);
+  lights.addLayer(makeBuiltinPattern(68), 5);
+  // Let every thread reach its steady state before counting
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  auto allocationsBefore = allocationCount.load();
+  auto framesBefore = lights.frameCount();
+  const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+  for (std::size_t i = 0; i < events; i++) {
+    while (i - controller.getStats().eventsReceived >= window) {
+      std::this_thread::yield();
+    }
+    injectMixed(*device, i);
+  }
+  while (controller.getStats().eventsReceived < events) {
+    std::this_thread::yield();
+  }
+  while (lights.frameCount() < framesBefore + 20) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  auto allocations = allocationCount.load() - allocationsBefore;
+  auto frames = lights.frameCount() - framesBefore;
+  auto stats = controller.getStats();
+  lights.stopCurrentPattern();
+
+  std::printf("%s\n    \"realtime\": {\"events\": %zu, \"frames\": %llu, \"allocations_after_connect\": %llu, \"latency_p50_us\": %.3f, "
+              "\"latency_p99_upper_us\": %.3f, \"ok\": %s}",
+              first ? "" : ",", events, static_cast<unsigned long long>(frames), static_cast<unsigned long long>(allocations),
+              static_cast<double>(stats.inputLatency.percentileNs(0.50)) / 1000.0,
+              static_cast<double>(stats.inputLatency.percentileNs(0.99)) / 1000.0, allocations == 0 ? "true" : "false");
+  first = false;
+  return allocations == 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool quick = argc > 1 && std::strcmp(argv[1], "--quick") == 0;
+  std::size_t scale = quick ? 10 : 1;
+
+  NullBuffer nullBuffer;
+  auto *coutBuffer = std::cout.rdbuf(&nullBuffer);
+  auto *cerrBuffer = std::cerr.rdbuf(&nullBuffer);
+
+  bool first = true;
+  std::printf("{\n  \"benchmark\": \"apc_bench\",\n  \"schema\": 1,\n  \"quick\": %s,\n  \"results\": {", quick ? "true" : "false");
+  benchInputLatency(20000 / scale, first);
+  benchPollingLatency(20000 / scale, first);
+  benchInputThroughput(200000 / scale, first);
+  benchPatterns(2000 / scale, first);
+  benchClip(2000 / scale, first);
+  benchGridLED(1000000 / scale, first);
+  benchBitboard(1000000 / scale, 100000 / scale, first);
+  benchHandlerDispatch(10000000 / scale, first);
+  benchReconnect(1000 / scale, first);
+  benchFaderStage(20000 / scale, first);
+  benchReplay(200000 / scale, first);
+  benchSharedBus(200000 / scale, first);
+  benchLedScheduler(500 / scale, false, first);
+  benchLedScheduler(500 / scale, true, first);
+  benchMidiClock(24000 / scale, 200000 / scale, first);
+#ifdef APC_MINI_COROUTINES
+  benchCues(10000, 100 / scale, first);
+#endif
+  // Last, since it locks the process's memory
+  bool realtimeOk = benchRealtime(200000 / scale, first);
+  std::printf("\n  }\n}\n");
+
+  std::cout.rdbuf(coutBuffer);
+  std::cerr.rdbuf(cerrBuffer);
+  return realtimeOk ? 0 : 1;
+}
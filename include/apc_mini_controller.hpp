@@ -1,13 +1,34 @@
 #ifndef APC_MINI_CONTROLLER_HPP
 #define APC_MINI_CONTROLLER_HPP
 
-#include <RtMidi.h>
+#include "button_set.hpp"
+#include "event_capture.hpp"
+#include "event_log.hpp"
+#include "event_signal.hpp"
+#include "fader_stage.hpp"
+#include "gesture_recognizer.hpp"
+#include "latency_histogram.hpp"
+#include "led_output_pipeline.hpp"
+#include "midi_clock.hpp"
+#include "midi_transport.hpp"
+#include "spsc_queue.hpp"
+#include "thread_policy.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
 #include <vector>
 
+class HandlerTable;
+
 class APCMiniController {
 public:
   enum class ButtonType {
@@ -48,45 +69,271 @@ public:
 
   using ButtonCallback = std::function<void(ButtonType type, int note, bool isPressed)>;
   using FaderCallback = std::function<void(Fader fader, int value)>;
+  using ConnectionCallback = std::function<void(bool connected)>;
+  using Gesture = GestureRecognizer::Gesture;
+  using GestureCallback = std::function<void(const Gesture &gesture)>;
+
+  // Raw input message as received from RtMidi, queued for the callback thread
+  struct MidiEvent {
+    double timeStamp;          // As delivered by the transport: seconds since the previous message
+    std::int64_t sourceTimeNs; // Steady-clock time the message left the device, rebuilt from timeStamp
+    unsigned char device;      // See setDeviceId()
+    unsigned char size;
+    unsigned char bytes[3];
+  };
+
+  static constexpr std::size_t EVENT_QUEUE_CAPACITY = 1024;
+  static constexpr std::size_t EVENT_BATCH_SIZE = 64;
 
+  // Uses the RtMidi backend
   APCMiniController();
+  // Uses the given backend, e.g. a VirtualApcMini for running without hardware
+  explicit APCMiniController(std::unique_ptr<MidiTransport> transport);
   ~APCMiniController();
 
-  bool connect();
+  // OWN_THREAD starts a callback thread for this controller. EXTERNAL starts none and the owner
+  // calls dispatchPending() instead, e.g. one thread servicing several devices. POLLING starts
+  // no threads at all: the application calls poll(), flushLEDs() and drainLog() from its own loop.
+  enum class DispatchMode { OWN_THREAD, EXTERNAL, POLLING };
+
+  // With waitForDevice a device that cannot be opened yet counts as lost rather than failing:
+  // connect() returns false, but the controller runs and checkConnection() opens the device
+  // once it appears.
+  bool connect(DispatchMode mode = DispatchMode::OWN_THREAD, bool waitForDevice = false);
   void disconnect();
-  bool isConnected() const { return midiIn && midiIn->isPortOpen(); }
+  bool isConnected() const { return transport && transport->isOpen(); }
+
+  // Hot-plug: if the device has disappeared the ports are closed, if it has come back they are
+  // reopened and the last known state of every LED is resent. Input dispatch keeps running
+  // throughout. Call periodically (see PortWatcher); returns isConnected().
+  bool checkConnection();
+  void setConnectionCallback(ConnectionCallback callback) { connectionCallback = callback; }
+
+  // Opt-in real-time operation for shared show machines. Set before connect(), which then
+  // locks the process's memory and runs the dispatch thread (OWN_THREAD mode) and the LED
+  // output thread under their policies. The input policy is applied by the thread delivering
+  // input (RtMidi's), on its first message after connect() or a reconnect. Nothing on the
+  // input, dispatch or output path allocates once connected, as long as the callbacks and
+  // handlers installed don't; see LightPatternController::setThreadPolicy() for animation.
+  struct RealtimeConfig {
+    ThreadPolicy input;
+    ThreadPolicy dispatch;
+    ThreadPolicy output;
+    bool lockMemory = true;
+  };
+  void setRealtime(const RealtimeConfig &config) {
+    realtime = config;
+    realtimeEnabled = true;
+  }
+
+  // Input as returned by poll()
+  struct ControllerEvent {
+    enum class Kind : unsigned char { BUTTON, FADER };
+    Kind kind;
+    ButtonType buttonType; // BUTTON only
+    unsigned char device;  // See setDeviceId()
+    unsigned char number;  // Note or control number
+    unsigned char value;   // BUTTON: 1 pressed, 0 released. FADER: 0-127
+    std::int64_t timeNs;   // Steady clock; for faders held back by the fader stage, when released
+
+    bool isPressed() const { return value != 0; }
+  };
+
+  // Dispatches up to one batch of queued input on the calling thread, returns the number handled
+  std::size_t dispatchPending();
+  // Drains all queued input on the calling thread into out, up to capacity events, and returns
+  // the number written. Callbacks, handlers and gestures run as with dispatchPending(); fader
+  // values are those left after the fader stage. Input beyond capacity waits for the next call;
+  // give room for at least FaderStage::FADER_COUNT events so held fader values can go out.
+  std::size_t poll(ControllerEvent *out, std::size_t capacity);
+  template <std::size_t N> std::size_t poll(std::array<ControllerEvent, N> &out) { return poll(out.data(), N); }
+  bool hasPendingEvents() const { return !eventQueue.empty() || wakeRequested.load(std::memory_order_acquire); }
+  // Makes the dispatching thread run a pass (and EventObserver::onDispatch) even without input.
+  // Callable from any thread.
+  void wake();
+  // How long the dispatching thread may sleep before held fader values or gestures fall due, at most maxWait
+  std::chrono::nanoseconds dispatchTimeout(std::chrono::nanoseconds maxWait) const;
+  // Raised whenever input is queued. Replace before connect() to share one signal between devices.
+  void setEventSignal(EventSignal *signal) { eventSignal = signal ? signal : &ownSignal; }
+  // Tag stamped on every input event, used to tell devices apart
+  void setDeviceId(int id) { deviceId = static_cast<unsigned char>(id); }
+  int getDeviceId() const { return deviceId; }
 
   void setGridLED(int index, LedColor color);
   void setHorizontalLED(HorizontalButton button, RoundLedState state);
   void setVerticalLED(VerticalButton button, RoundLedState state);
 
+  // LED setters never block: they publish the new state to an output thread, which sends only
+  // the latest value of each LED and only if it differs from what the device shows. Between
+  // beginFrame() and commitFrame() changes are held back and go out together on commit.
+  void beginFrame() { ledOutput.hold(); }
+  void commitFrame() { ledOutput.release(); }
+  // Resends the complete LED state, e.g. after the device was power cycled
+  void resyncLEDs() { ledOutput.invalidate(); }
+  // Sends pending LED changes on the calling thread and returns once they are written.
+  // In POLLING mode this is the only way LED changes reach the device.
+  void flushLEDs() { ledOutput.flush(); }
+  // Sets LEDs by note, bypassing beginFrame() holds from any thread, and writes them on the
+  // calling thread. Returns once written; false if the device write failed (they stay pending).
+  bool writeLEDsNow(const unsigned char *notes, const unsigned char *values, std::size_t count) {
+    return ledOutput.writeNow(notes, values, count);
+  }
+
   void setButtonCallback(ButtonCallback callback) { buttonCallback = callback; }
   void setFaderCallback(FaderCallback callback) { faderCallback = callback; }
+  // Coalesces and dejitters fader input before the FaderCallback (and the log) see it.
+  // Set before connect(); by default every fader message is delivered.
+  void setFaderStage(const FaderStage::Config &config) { faderStage.configure(config); }
+
+  // Per-note, per-button-class and per-fader handlers (see HandlerTable), called after the
+  // ButtonCallback and FaderCallback. Installing a table is one atomic store and is safe while
+  // input is being dispatched, including from inside a handler; the replaced table is freed
+  // by a later setHandlers() once the dispatching thread has finished with it. nullptr removes.
+  void setHandlers(std::unique_ptr<HandlerTable> table);
 
+  // Sees every button and fader event on the dispatching thread, after the callbacks and
+  // handlers, plus a call at the end of every dispatch pass. Used to drive schedulers that live
+  // on the dispatching thread, such as CueExecutor.
+  class EventObserver {
+  public:
+    virtual ~EventObserver() = default;
+    virtual void onButton(int /*note*/, bool /*isPressed*/) {}
+    virtual void onFader(int /*controlNumber*/, int /*value*/) {}
+    virtual void onDispatch() {}
+  };
+  static constexpr std::size_t MAX_OBSERVERS = 8;
+  // Returns false if all slots are taken. An observer may be added at any time but removed only
+  // from the dispatching thread or while nothing is dispatching.
+  bool addObserver(EventObserver *observer);
+  void removeObserver(EventObserver *observer);
+
+  // Long presses, double taps and chords, detected on the dispatching thread after the
+  // ButtonCallback has seen the presses involved. Configure the timing before connect().
+  void setGestureCallback(GestureCallback callback) { gestureCallback = callback; }
+  void setGestureConfig(const GestureRecognizer::Config &config) { gestures.configure(config); }
+
+  // Buttons currently held, as bitboards (see ButtonSet). Updated on the dispatching thread
+  // before the ButtonCallback runs; safe to read from any thread.
+  ButtonSet pressedButtons() const {
+    return {pressedGrid.load(std::memory_order_relaxed), pressedRound.load(std::memory_order_relaxed)};
+  }
+  bool isPressed(int note) const { return pressedButtons().contains(note); }
+  std::uint64_t pressedGridMask() const { return pressedGrid.load(std::memory_order_relaxed); }
+
+  // Throws std::runtime_error for notes without a button; ApcMiniLayout::noteInfo() does not throw
   static ButtonType getButtonType(int note);
-  static std::string buttonTypeToString(ButtonType type);
-  static std::string getButtonName(int note);
-  static std::string getFaderName(int fader);
+  static std::string_view buttonTypeToString(ButtonType type);
+  static std::string_view getButtonName(int note);
+  static std::string_view getFaderName(int fader);
+
+  // Number of input messages discarded because the event queue was full
+  std::size_t droppedEventCount() const { return droppedEvents.load(std::memory_order_relaxed); }
+
+  struct Stats {
+    std::uint64_t eventsReceived = 0;
+    std::uint64_t eventsDropped = 0;
+    std::uint64_t messagesSent = 0;
+    std::uint64_t bytesSent = 0;
+    std::uint64_t writeBatches = 0; // Transport writes carrying the messages above
+    std::uint64_t reconnects = 0;
+    std::uint64_t faderUpdates = 0;    // Fader messages received
+    std::uint64_t faderDeliveries = 0; // FaderCallback invocations after the fader stage
+    std::uint64_t realtimeMessages = 0; // MIDI clock, start, stop, ...: handled on arrival, never queued
+    LatencyHistogram::Snapshot inputLatency; // Device timestamp to dispatch
+    LatencyHistogram::Snapshot callbackTime; // Time spent inside button and fader callbacks
+    LatencyHistogram::Snapshot restoreTime;  // Reconnect to every LED resent
+    std::chrono::steady_clock::time_point takenAt;
+
+    // Output rates over the interval between two snapshots
+    static double messagesPerSecond(const Stats &earlier, const Stats &later);
+    static double bytesPerSecond(const Stats &earlier, const Stats &later);
+  };
+
+  // Lock-free snapshot, safe to poll from any thread
+  Stats getStats() const;
+  void resetStats();
+
+  // Button and fader events are logged asynchronously at LogLevel::INFO
+  void setLogLevel(LogLevel level) { eventLog.setLevel(level); }
+  // Prints queued log records on the calling thread; in POLLING mode nothing else does
+  std::size_t drainLog() { return eventLog.drain(); }
+  EventLog &getEventLog() { return eventLog; }
+
+  // Tempo and beat phase of MIDI clock arriving on this input. Clock, Start, Continue and Stop
+  // are taken off the input thread before the event queue, so they never compete with buttons.
+  const MidiClock &getMidiClock() const { return midiClock; }
+
+  // Records every inbound message and outbound LED message into capture; nullptr stops.
+  // The capture must stay alive until it is detached or the controller is disconnected.
+  void setCapture(EventCapture *target) { capture.store(target, std::memory_order_release); }
 
 private:
   std::unique_ptr<std::thread> callbackThread;
-  std::function<void()> pendingCallback;
-  std::mutex callbackMutex;
-  std::condition_variable callbackCV;
+  std::atomic<bool> active{false};     // Between connect() and disconnect(), even while the device is lost
+  std::atomic<bool> deviceLost{false}; // Owned by checkConnection()
+  ConnectionCallback connectionCallback;
+  SpscQueue<MidiEvent, EVENT_QUEUE_CAPACITY> eventQueue;
+  std::atomic<std::size_t> droppedEvents{0};
+  std::int64_t lastSourceTimeNs = 0; // Owned by the transport input thread
+  MidiClock midiClock;               // Fed by the transport input thread
+  EventSignal ownSignal;
+  EventSignal *eventSignal = &ownSignal;
+  unsigned char deviceId = 0;
+  DispatchMode dispatchMode = DispatchMode::OWN_THREAD;
+  RealtimeConfig realtime;
+  bool realtimeEnabled = false;
+  std::atomic<bool> inputPolicyPending{false}; // Applied by the next midiCallback
+  ControllerEvent *pollOut = nullptr;          // Set for the duration of poll()
+  std::size_t pollCapacity = 0;
+  std::size_t pollCount = 0;
 
-  static void midiCallback(double timeStamp, std::vector<unsigned char> *message, void *userData);
+  static void midiCallback(double timeStamp, const unsigned char *data, std::size_t size, void *userData);
   void processCallback();
 
-  std::unique_ptr<RtMidiIn> midiIn;
-  std::unique_ptr<RtMidiOut> midiOut;
+  std::unique_ptr<MidiTransport> transport;
   ButtonCallback buttonCallback;
   FaderCallback faderCallback;
 
-  void handleMidiMessage(const std::vector<unsigned char> &message);
-  void sendMidiMessage(const std::vector<unsigned char> &message);
-  bool findAndOpenPorts();
+  std::atomic<std::uint64_t> eventsReceived{0};
+  std::atomic<std::uint64_t> messagesSent{0};
+  std::atomic<std::uint64_t> bytesSent{0};
+  std::atomic<std::uint64_t> writeBatches{0};
+  std::atomic<std::uint64_t> reconnects{0};
+  std::atomic<std::uint64_t> faderUpdates{0};
+  std::atomic<std::uint64_t> faderDeliveries{0};
+  std::atomic<std::uint64_t> realtimeMessages{0};
+  LatencyHistogram inputLatency;
+  LatencyHistogram callbackTime;
+  LatencyHistogram restoreTime;
+  EventLog eventLog;
+  std::size_t reportedDrops = 0; // Owned by the dispatching thread
+  std::atomic<EventCapture *> capture{nullptr};
+
+  FaderStage faderStage; // Owned by the dispatching thread
+  std::array<std::atomic<EventObserver *>, MAX_OBSERVERS> observers{};
+  std::atomic<bool> wakeRequested{false};
+  std::atomic<const HandlerTable *> handlers{nullptr};
+  std::atomic<std::uint64_t> dispatchPasses{0}; // Completed dispatchPending() calls
+  std::mutex handlerMutex;                      // Serializes setHandlers(), never taken by dispatch
+  std::unique_ptr<HandlerTable> installedHandlers;
+  std::vector<std::pair<std::unique_ptr<HandlerTable>, std::uint64_t>> retiredHandlers; // With dispatchPasses at retirement
+
+  GestureRecognizer gestures; // Owned by the dispatching thread
+  GestureCallback gestureCallback;
+  std::atomic<std::uint64_t> pressedGrid{0}; // Written by the dispatching thread only
+  std::atomic<std::uint32_t> pressedRound{0};
+
+  std::size_t dispatchBatch(std::size_t maxEvents);
+  void handleMidiMessage(const MidiEvent &event);
+  void deliverFader(int controlNumber, int value, std::int64_t timeNs);
+  void deliverGesture(const Gesture &gesture);
+  void runTimers(); // Fader values and gestures that fall due with time
+  void notifyDispatch();
+  bool sendMidiMessages(const unsigned char *data, std::size_t size, std::size_t messageCount);
+  void setLED(int note, unsigned char value) { ledOutput.set(note, value); }
 
-  static const std::vector<std::vector<int>> GRID_LAYOUT;
+  std::mutex transportMutex; // Output writes against open/close
+  LedOutputPipeline ledOutput;
 };
 
 #endif
@@ -0,0 +1,136 @@
+#ifndef APC_MINI_LAYOUT_HPP
+#define APC_MINI_LAYOUT_HPP
+
+#include "apc_mini_controller.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Compile-time lookup tables for the APC Mini note map. Decoding a note or addressing an
+// LED is a single table load; nothing here allocates or throws.
+class ApcMiniLayout {
+public:
+  using ButtonType = APCMiniController::ButtonType;
+
+  struct NoteInfo {
+    bool valid;            // False for notes with no button
+    ButtonType type;       // Only meaningful when valid
+    std::uint8_t index;    // Grid: LED index (0 = top left), round buttons: 0-7 left to right / top to bottom
+    std::string_view name; // "Grid[r,c]", "Stop All", "Scene 1", ...
+  };
+
+  static constexpr int NOTE_COUNT = 128;
+  static constexpr int GRID_SIZE = 64;
+  static constexpr int FADER_FIRST = 48;
+  static constexpr int FADER_COUNT = 9;
+
+  static constexpr const NoteInfo &noteInfo(int note) {
+    return (note >= 0 && note < NOTE_COUNT) ? NOTE_TABLE[static_cast<std::size_t>(note)] : INVALID_NOTE;
+  }
+  // LED index used by setGridLED (row 0 is the top row) to note number
+  static constexpr int gridNote(int index) { return GRID_NOTES[static_cast<std::size_t>(index)]; }
+  // Note number to LED index, -1 if the note is not on the grid
+  static constexpr int gridIndex(int note) {
+    return (note >= 0 && note < GRID_SIZE) ? NOTE_TABLE[static_cast<std::size_t>(note)].index : -1;
+  }
+  static constexpr std::string_view faderName(int controlNumber) {
+    return (controlNumber >= FADER_FIRST && controlNumber < FADER_FIRST + FADER_COUNT)
+               ? FADER_NAMES[static_cast<std::size_t>(controlNumber - FADER_FIRST)]
+               : std::string_view("Unknown Fader");
+  }
+  static constexpr std::string_view typeName(ButtonType type) {
+    switch (type) {
+    case ButtonType::GRID:
+      return "Grid";
+    case ButtonType::HORIZONTAL:
+      return "Horizontal";
+    case ButtonType::VERTICAL:
+      return "Vertical";
+    case ButtonType::SPECIAL:
+      return "Special";
+    }
+    return "Unknown";
+  }
+
+private:
+  using GridNameStorage = std::array<std::array<char, 10>, GRID_SIZE>;
+
+  // "Grid[row,col]" with row = note / 8, counted from the bottom as the device numbers notes
+  static constexpr GridNameStorage buildGridNames() {
+    GridNameStorage names{};
+    for (int note = 0; note < GRID_SIZE; note++) {
+      auto &name = names[static_cast<std::size_t>(note)];
+      const char prefix[] = "Grid[";
+      for (std::size_t i = 0; i < 5; i++) {
+        name[i] = prefix[i];
+      }
+      name[5] = static_cast<char>('0' + note / 8);
+      name[6] = ',';
+      name[7] = static_cast<char>('0' + note % 8);
+      name[8] = ']';
+      name[9] = '\0';
+    }
+    return names;
+  }
+
+  static constexpr std::array<int, GRID_SIZE> buildGridNotes() {
+    std::array<int, GRID_SIZE> notes{};
+    for (int index = 0; index < GRID_SIZE; index++) {
+      notes[static_cast<std::size_t>(index)] = (7 - index / 8) * 8 + index % 8;
+    }
+    return notes;
+  }
+
+  static constexpr std::array<NoteInfo, NOTE_COUNT> buildNoteTable() {
+    std::array<NoteInfo, NOTE_COUNT> table{};
+    for (auto &entry : table) {
+      entry = INVALID_NOTE;
+    }
+    for (int note = 0; note < GRID_SIZE; note++) {
+      table[static_cast<std::size_t>(note)] = {true, ButtonType::GRID, static_cast<std::uint8_t>((7 - note / 8) * 8 + note % 8),
+                                               std::string_view(GRID_NAMES[static_cast<std::size_t>(note)].data(), 9)};
+    }
+    for (std::size_t i = 0; i < 8; i++) {
+      table[64 + i] = {true, ButtonType::HORIZONTAL, static_cast<std::uint8_t>(i), HORIZONTAL_NAMES[i]};
+      table[82 + i] = {true, ButtonType::VERTICAL, static_cast<std::uint8_t>(i), VERTICAL_NAMES[i]};
+    }
+    table[98] = {true, ButtonType::SPECIAL, 0, "Shift"};
+    return table;
+  }
+
+  static constexpr NoteInfo INVALID_NOTE{false, ButtonType::SPECIAL, 0, "Unknown"};
+  static constexpr std::array<std::string_view, 8> HORIZONTAL_NAMES{"Stop All", "Left", "Right", "Up", "Down", "Volume", "Pan", "Send"};
+  static constexpr std::array<std::string_view, 8> VERTICAL_NAMES{"Scene 1", "Scene 2", "Scene 3", "Scene 4",
+                                                                  "Scene 5", "Scene 6", "Scene 7", "Scene 8"};
+  static constexpr std::array<std::string_view, FADER_COUNT> FADER_NAMES{"Track 1", "Track 2", "Track 3", "Track 4", "Track 5",
+                                                                         "Track 6", "Track 7", "Track 8", "Master"};
+  static const GridNameStorage GRID_NAMES;
+  static const std::array<int, GRID_SIZE> GRID_NOTES;
+  static const std::array<NoteInfo, NOTE_COUNT> NOTE_TABLE;
+};
+
+inline constexpr ApcMiniLayout::GridNameStorage ApcMiniLayout::GRID_NAMES = ApcMiniLayout::buildGridNames();
+inline constexpr std::array<int, ApcMiniLayout::GRID_SIZE> ApcMiniLayout::GRID_NOTES = ApcMiniLayout::buildGridNotes();
+inline constexpr std::array<ApcMiniLayout::NoteInfo, ApcMiniLayout::NOTE_COUNT> ApcMiniLayout::NOTE_TABLE = ApcMiniLayout::buildNoteTable();
+
+// The tables must agree with the device's physical layout
+static_assert(ApcMiniLayout::gridNote(0) == 56 && ApcMiniLayout::gridNote(7) == 63, "Top grid row is notes 56-63");
+static_assert(ApcMiniLayout::gridNote(56) == 0 && ApcMiniLayout::gridNote(63) == 7, "Bottom grid row is notes 0-7");
+static_assert(ApcMiniLayout::noteInfo(64).type == ApcMiniLayout::ButtonType::HORIZONTAL && ApcMiniLayout::noteInfo(71).index == 7);
+static_assert(ApcMiniLayout::noteInfo(82).type == ApcMiniLayout::ButtonType::VERTICAL && ApcMiniLayout::noteInfo(89).name == "Scene 8");
+static_assert(ApcMiniLayout::noteInfo(98).type == ApcMiniLayout::ButtonType::SPECIAL && ApcMiniLayout::noteInfo(98).name == "Shift");
+static_assert(!ApcMiniLayout::noteInfo(72).valid && !ApcMiniLayout::noteInfo(90).valid && !ApcMiniLayout::noteInfo(-1).valid);
+static_assert(ApcMiniLayout::noteInfo(11).name == "Grid[1,3]", "Grid names count rows from the bottom");
+static_assert(ApcMiniLayout::faderName(48) == "Track 1" && ApcMiniLayout::faderName(56) == "Master");
+static_assert(
+    [] {
+      for (int index = 0; index < ApcMiniLayout::GRID_SIZE; index++) {
+        if (ApcMiniLayout::gridIndex(ApcMiniLayout::gridNote(index)) != index)
+          return false;
+      }
+      return true;
+    }(),
+    "gridIndex must invert gridNote");
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef BUTTON_SET_HPP
+#define BUTTON_SET_HPP
+
+#include <cstdint>
+
+// A set of APC Mini buttons as bitboards. Bit i of grid is LED index i (row 0 is the top row,
+// as in setGridLED); round bits 0-7 are the horizontal buttons (notes 64-71), 8-15 the scene
+// buttons (82-89) and 16 is Shift (98). Membership, union and counting are single mask
+// operations.
+struct ButtonSet {
+  std::uint64_t grid = 0;
+  std::uint32_t round = 0;
+
+  static constexpr std::uint64_t ROW_MASK = 0xFFull;
+  static constexpr std::uint64_t COLUMN_MASK = 0x0101010101010101ull;
+
+  static constexpr std::uint64_t rowMask(int row) { return ROW_MASK << (row * 8); }
+  static constexpr std::uint64_t columnMask(int col) { return COLUMN_MASK << col; }
+
+  // Note to bit; a set with no bits for notes without a button
+  static constexpr ButtonSet fromNote(int note) {
+    ButtonSet set;
+    if (note >= 0 && note < 64)
+      set.grid = std::uint64_t{1} << ((7 - note / 8) * 8 + note % 8);
+    else if (note >= 64 && note <= 71)
+      set.round = 1u << (note - 64);
+    else if (note >= 82 && note <= 89)
+      set.round = 1u << (note - 82 + 8);
+    else if (note == 98)
+      set.round = 1u << 16;
+    return set;
+  }
+
+  constexpr bool contains(int note) const {
+    auto bit = fromNote(note);
+    return (grid & bit.grid) != 0 || (round & bit.round) != 0;
+  }
+  constexpr bool empty() const { return grid == 0 && round == 0; }
+  constexpr int count() const { return popcount(grid) + popcount(round); }
+
+  constexpr ButtonSet operator|(ButtonSet other) const { return {grid | other.grid, round | other.round}; }
+  constexpr ButtonSet operator&(ButtonSet other) const { return {grid & other.grid, round & other.round}; }
+  constexpr ButtonSet without(ButtonSet other) const { return {grid & ~other.grid, round & ~other.round}; }
+  constexpr bool operator==(ButtonSet other) const { return grid == other.grid && round == other.round; }
+  constexpr bool operator!=(ButtonSet other) const { return !(*this == other); }
+
+  // Calls fn(note) for each button in the set, grid first, visiting only the set bits
+  template <typename Fn> constexpr void forEachNote(Fn &&fn) const {
+    for (auto bits = grid; bits != 0; bits &= bits - 1) {
+      int index = lowestBit(bits);
+      fn((7 - index / 8) * 8 + index % 8);
+    }
+    for (auto bits = std::uint64_t{round}; bits != 0; bits &= bits - 1) {
+      int bit = lowestBit(bits);
+      fn(bit < 8 ? 64 + bit : bit < 16 ? 82 + bit - 8 : 98);
+    }
+  }
+
+  static constexpr int lowestBit(std::uint64_t bits) { return popcount((bits & (~bits + 1)) - 1); }
+  static constexpr int popcount(std::uint64_t bits) {
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((bits * 0x0101010101010101ull) >> 56);
+  }
+};
+
+static_assert(ButtonSet::fromNote(56).grid == 1 && ButtonSet::fromNote(7).grid == (std::uint64_t{1} << 63), "Grid bits follow setGridLED order");
+static_assert(ButtonSet::fromNote(71).round == 0x80 && ButtonSet::fromNote(82).round == 0x100 && ButtonSet::fromNote(98).round == 0x10000);
+static_assert((ButtonSet::fromNote(0) | ButtonSet::fromNote(64) | ButtonSet::fromNote(89)).count() == 3);
+static_assert(ButtonSet::lowestBit(0x80) == 7 && ButtonSet::fromNote(72).empty() && ButtonSet::rowMask(7) == (0xFFull << 56));
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef CAPTURE_REPLAYER_HPP
+#define CAPTURE_REPLAYER_HPP
+
+#include "apc_mini_controller.hpp"
+#include "event_capture.hpp"
+#include "virtual_apc_mini.hpp"
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// Plays the inbound side of a capture into a controller through a VirtualApcMini, so it runs
+// the normal input path: queue, dispatch, handleMidiMessage and whatever the callbacks drive
+// (e.g. the pattern engine). Afterwards the LED state the device ended up with is compared
+// with the last outbound state in the capture.
+class CaptureReplayer {
+public:
+  enum class Speed {
+    REAL_TIME, // Keeps the captured spacing between messages
+    FAST       // As fast as the controller drains its queue, without dropping events
+  };
+
+  struct Result {
+    std::size_t inbound = 0;     // Messages injected
+    std::size_t dispatched = 0;  // Messages the controller took off its queue
+    std::size_t dropped = 0;     // Lost to a full queue
+    double seconds = 0;
+    double eventsPerSecond = 0;
+    int ledMismatches = -1;      // LEDs that differ from the capture, -1 if it recorded no output
+  };
+
+  // The device must be the controller's transport and the controller must be connected
+  CaptureReplayer(APCMiniController &controller, VirtualApcMini &device);
+
+  Result replay(const std::vector<EventCapture::Record> &records, Speed speed);
+
+  // Final LED state per note according to the outbound records; false if there were none
+  static bool expectedLedState(const std::vector<EventCapture::Record> &records, std::array<int, 128> &leds);
+
+private:
+  APCMiniController &controller;
+  VirtualApcMini &device;
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef CUE_EXECUTOR_HPP
+#define CUE_EXECUTOR_HPP
+
+#if !defined(__cpp_impl_coroutine)
+#error "cue_executor.hpp needs C++20 coroutines; configure with -DAPC_MINI_COROUTINES=ON"
+#endif
+
+#include "apc_mini_controller.hpp"
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class CueExecutor;
+class LightPatternController;
+
+// A show cue: a coroutine handed to CueExecutor::spawn(). It runs on the controller's
+// dispatching thread and suspends only where it co_awaits one of the executor's awaitables.
+class Cue {
+public:
+  struct promise_type {
+    CueExecutor *executor = nullptr;
+    promise_type *previous = nullptr; // The executor's list of running cues
+    promise_type *next = nullptr;
+
+    Cue get_return_object() { return Cue(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception();
+    ~promise_type();
+  };
+
+  Cue(Cue &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+  Cue &operator=(Cue &&) = delete;
+  ~Cue() {
+    if (handle)
+      handle.destroy();
+  }
+
+private:
+  friend class CueExecutor;
+  explicit Cue(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+  std::coroutine_handle<promise_type> handle;
+};
+
+// Single-threaded scheduler for cues, driven by the controller's dispatch passes (own thread,
+// DeviceManager, dispatchPending() or poll()). A waiting cue costs its coroutine frame and
+// nothing else: waits are intrusive list nodes inside the frame, resumed by the event they wait
+// for. Destroy the executor after disconnect() or on the dispatching thread; cues still waiting
+// are destroyed with it.
+class CueExecutor : private APCMiniController::EventObserver {
+  struct Waiter {
+    std::coroutine_handle<> handle;
+    Waiter *next = nullptr;
+    int threshold = 0;         // faderAbove()
+    std::uint64_t frame = 0;   // frames(): frame count to wait for
+    int value = 0;             // faderAbove(): the value that passed
+  };
+
+public:
+  // Throws std::runtime_error if the controller has no free observer slot. frames() needs patterns.
+  explicit CueExecutor(APCMiniController &controller, LightPatternController *patterns = nullptr);
+  ~CueExecutor() override;
+  CueExecutor(const CueExecutor &) = delete;
+  CueExecutor &operator=(const CueExecutor &) = delete;
+
+  // Starts the cue on the next dispatch pass. Callable from any thread, including from a cue.
+  void spawn(Cue cue);
+  // Cues started and not yet finished; dispatching thread only
+  std::size_t runningCues() const { return running; }
+
+  class PressAwaiter {
+  public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      waiter.handle = handle;
+      executor.push(executor.pressWaiters[static_cast<std::size_t>(note)], waiter);
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    friend class CueExecutor;
+    PressAwaiter(CueExecutor &owner, int button) : executor(owner), note(button) {}
+    CueExecutor &executor;
+    int note;
+    Waiter waiter;
+  };
+
+  class FaderAwaiter {
+  public:
+    bool await_ready() noexcept {
+      waiter.value = executor.faderValues[slot];
+      return waiter.value > waiter.threshold;
+    }
+    void await_suspend(std::coroutine_handle<> handle) {
+      waiter.handle = handle;
+      executor.push(executor.faderWaiters[slot], waiter);
+    }
+    // The fader value that crossed the threshold
+    int await_resume() const noexcept { return waiter.value; }
+
+  private:
+    friend class CueExecutor;
+    FaderAwaiter(CueExecutor &owner, std::size_t fader, int threshold) : executor(owner), slot(fader) { waiter.threshold = threshold; }
+    CueExecutor &executor;
+    std::size_t slot;
+    Waiter waiter;
+  };
+
+  class FrameAwaiter {
+  public:
+    bool await_ready() const noexcept { return count == 0; }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {}
+
+  private:
+    friend class CueExecutor;
+    FrameAwaiter(CueExecutor &owner, std::uint64_t frames) : executor(owner), count(frames) {}
+    CueExecutor &executor;
+    std::uint64_t count;
+    Waiter waiter;
+  };
+
+  // Next press (not release) of a button. Throws std::invalid_argument for notes without a button.
+  PressAwaiter nextPress(int note);
+  // Until the fader is above value; ready at once if its last known value already is
+  FaderAwaiter faderAbove(APCMiniController::Fader fader, int value);
+  // Until the LightPatternController has output n more frames. Throws std::logic_error without one.
+  FrameAwaiter frames(std::uint64_t n);
+
+private:
+  friend struct Cue::promise_type;
+
+  APCMiniController &controller;
+  LightPatternController *patterns;
+
+  std::array<Waiter *, 128> pressWaiters{};
+  std::array<Waiter *, 9> faderWaiters{};
+  std::array<int, 9> faderValues{-1, -1, -1, -1, -1, -1, -1, -1, -1};
+  Waiter *frameWaiters = nullptr;
+  std::atomic<bool> wakeOnFrame{false}; // Read by the animation thread
+  std::uint64_t lastFrame = 0;
+
+  Cue::promise_type *cues = nullptr; // Running cues, for destruction
+  std::size_t running = 0;
+
+  std::mutex spawnMutex;
+  std::vector<std::coroutine_handle<Cue::promise_type>> spawned; // Guarded by spawnMutex
+  std::atomic<bool> hasSpawned{false};                           // Keeps the lock off idle passes
+
+  static void push(Waiter *&list, Waiter &waiter) {
+    waiter.next = list;
+    list = &waiter;
+  }
+  void start(std::coroutine_handle<Cue::promise_type> handle);
+  void unlink(Cue::promise_type &promise);
+
+  void onButton(int note, bool isPressed) override;
+  void onFader(int controlNumber, int value) override;
+  void onDispatch() override;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef DEVICE_MANAGER_HPP
+#define DEVICE_MANAGER_HPP
+
+#include "apc_mini_controller.hpp"
+#include "event_signal.hpp"
+#include "midi_transport.hpp"
+#include "port_watcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drives several chained APC Minis from one process. Every device keeps its own controller
+// (input queue, LED framebuffer, stats) but all of them are serviced by a single dispatch
+// thread, and callbacks report which device an event came from. The grids are addressable as
+// one canvas: device 0 is the leftmost 8 columns, device 1 the next 8, and so on.
+class DeviceManager {
+public:
+  static constexpr int MAX_DEVICES = 4;
+
+  using ButtonType = APCMiniController::ButtonType;
+  using Fader = APCMiniController::Fader;
+  using LedColor = APCMiniController::LedColor;
+  using ButtonCallback = std::function<void(int device, ButtonType type, int note, bool isPressed)>;
+  using FaderCallback = std::function<void(int device, Fader fader, int value)>;
+
+  DeviceManager() = default;
+  ~DeviceManager();
+  DeviceManager(const DeviceManager &) = delete;
+  DeviceManager &operator=(const DeviceManager &) = delete;
+
+  // Adds one RtMidi device per port pair whose name contains portName, in port order.
+  // Returns the number of devices added.
+  std::size_t addMatchingPorts(const std::string &portName = "APC MINI");
+  // Adds a device on any backend. Returns its id (its canvas position), or -1 when full.
+  int addDevice(std::unique_ptr<MidiTransport> transport);
+
+  // Connects every device and starts the dispatch thread. Devices and callbacks must be
+  // set up before this; returns false if any device failed to open. With hot-plug on, such
+  // devices are opened later, when the PortWatcher sees them appear.
+  bool start();
+  void stop();
+  bool isRunning() const { return running.load(); }
+  // How often start()'s PortWatcher looks for unplugged and replugged devices; 0 disables it
+  void setHotPlugInterval(std::chrono::milliseconds interval) { hotPlugInterval = interval; }
+  // Applied to every device by start(); the dispatch policy goes to the shared dispatch thread
+  void setRealtime(const APCMiniController::RealtimeConfig &config) { realtime = config; }
+
+  std::size_t deviceCount() const { return devices.size(); }
+  APCMiniController &device(int id) { return *devices.at(static_cast<std::size_t>(id)); }
+  // In canvas order, e.g. for LightPatternController
+  std::vector<APCMiniController *> controllers() const;
+
+  void setButtonCallback(ButtonCallback callback) { buttonCallback = std::move(callback); }
+  void setFaderCallback(FaderCallback callback) { faderCallback = std::move(callback); }
+
+  // Canvas coordinates: x from 0 to canvasWidth() - 1 left to right, y = 0 is the top row
+  int canvasWidth() const { return static_cast<int>(devices.size()) * 8; }
+  static constexpr int canvasHeight() { return 8; }
+  void setCanvasLED(int x, int y, LedColor color);
+  // Frame every device, see APCMiniController::beginFrame()
+  void beginFrame();
+  void commitFrame();
+
+private:
+  std::vector<std::unique_ptr<APCMiniController>> devices;
+  EventSignal signal; // Shared by every device's input queue
+  std::unique_ptr<std::thread> dispatchThread;
+  std::atomic<bool> running{false};
+  std::chrono::milliseconds hotPlugInterval = PortWatcher::DEFAULT_INTERVAL;
+  std::optional<APCMiniController::RealtimeConfig> realtime;
+  std::unique_ptr<PortWatcher> portWatcher;
+  ButtonCallback buttonCallback;
+  FaderCallback faderCallback;
+
+  void dispatchLoop();
+  bool hasPendingEvents() const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef EVENT_CAPTURE_HPP
+#define EVENT_CAPTURE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Records what a controller received and sent, for reproducing field issues offline.
+// Records are 16 bytes and go into a buffer allocated up front: writers claim a slot with
+// one atomic increment, so the input thread and the LED output thread can both record
+// without locks. Once the buffer is full further records are counted and dropped.
+//
+// File layout (host byte order): 8-byte magic "APCCAP01", uint32 record size, uint32
+// reserved, uint64 record count, then the records.
+class EventCapture {
+public:
+  enum class Direction : std::uint8_t { INBOUND = 0, OUTBOUND = 1 };
+
+  struct Record {
+    std::int64_t timeNs;  // Steady clock: device time for inbound, write time for outbound
+    float rtMidiDelta;    // Inbound: the transport's timestamp, seconds since the previous message
+    std::uint8_t flags;   // Direction in bit 7, message size in the low bits
+    std::uint8_t bytes[3];
+
+    Direction direction() const { return (flags & 0x80) ? Direction::OUTBOUND : Direction::INBOUND; }
+    std::size_t size() const { return flags & 0x03; }
+  };
+  static_assert(sizeof(Record) == 16, "Capture records are 16 bytes on disk");
+
+  explicit EventCapture(std::size_t capacity);
+
+  // Recording is on from construction until stop()
+  void recordInbound(std::int64_t timeNs, double rtMidiDelta, const unsigned char *data, std::size_t size);
+  void recordOutbound(std::int64_t timeNs, const unsigned char *data, std::size_t size);
+  void stop() { recording.store(false, std::memory_order_release); }
+
+  std::size_t size() const;
+  std::size_t capacity() const { return records.size(); }
+  std::uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+
+  // Copies the finished records; call after stop() once writers are quiet
+  std::vector<Record> snapshot() const;
+  bool save(const std::string &path) const;
+  static bool load(const std::string &path, std::vector<Record> &out);
+
+private:
+  std::vector<Record> records;
+  std::atomic<std::size_t> nextSlot{0};
+  std::atomic<std::size_t> written{0};
+  std::atomic<std::uint64_t> dropped{0};
+  std::atomic<bool> recording{true};
+
+  void append(std::int64_t timeNs, float rtMidiDelta, Direction direction, const unsigned char *data, std::size_t size);
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef EVENT_LOG_HPP
+#define EVENT_LOG_HPP
+
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Highest level compiled into the library (see LogLevel). Records above it are removed at compile time.
+#ifndef APC_LOG_LEVEL
+#define APC_LOG_LEVEL 2
+#endif
+
+enum class LogLevel { OFF = 0, WARN = 1, INFO = 2, DEBUG = 3 };
+
+// Structured binary event log. The dispatch thread writes fixed-size records into a ring
+// buffer; a background thread formats and prints them, so the hot path never touches
+// strings or streams. Without start(), whoever owns the log formats with drain() instead.
+// There must be a single producer thread.
+class EventLog {
+public:
+  static constexpr LogLevel COMPILED_LEVEL = static_cast<LogLevel>(APC_LOG_LEVEL);
+  static constexpr std::size_t CAPACITY = 4096;
+
+  enum class Kind : std::uint8_t {
+    BUTTON,    // bytes: button type, note, pressed
+    FADER,     // bytes: control number, value
+    DROPPED,   // value: input events dropped since the last report
+    UNHANDLED, // bytes: raw message
+  };
+
+  struct Record {
+    std::int64_t timeNs;
+    std::uint32_t value;
+    Kind kind;
+    LogLevel level;
+    unsigned char bytes[2];
+  };
+
+  static constexpr bool compiledIn(LogLevel level) { return level != LogLevel::OFF && level <= COMPILED_LEVEL; }
+
+  explicit EventLog(std::ostream &output);
+  ~EventLog();
+
+  void start();
+  void stop();
+  // Formats and prints everything queued on the calling thread; only while not started
+  std::size_t drain();
+
+  void setLevel(LogLevel newLevel) { level.store(newLevel, std::memory_order_relaxed); }
+  LogLevel getLevel() const { return level.load(std::memory_order_relaxed); }
+  bool enabled(LogLevel recordLevel) const { return recordLevel <= getLevel(); }
+
+  // Producer side; callers guard with `if constexpr (EventLog::compiledIn(...))`
+  void write(LogLevel recordLevel, Kind kind, unsigned char byte0, unsigned char byte1 = 0, std::uint32_t value = 0);
+
+  // Records lost because the formatter fell behind
+  std::uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  std::ostream &output;
+  std::atomic<LogLevel> level{LogLevel::INFO};
+  SpscQueue<Record, CAPACITY> queue;
+  std::atomic<std::uint64_t> dropped{0};
+
+  std::unique_ptr<std::thread> formatThread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool running = false;
+
+  void formatLoop();
+  void format(const Record &record);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef EVENT_SIGNAL_HPP
+#define EVENT_SIGNAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Lets lock-free producers wake a consumer that sleeps while it has nothing to do. The
+// producer only touches the mutex when the consumer is actually asleep. One signal can be
+// shared by several producers (e.g. every device serviced by one dispatch thread).
+class EventSignal {
+public:
+  // Producer side, after the work item has been published
+  void notify() {
+    // Pairs with the fence in wait() so either the consumer sees the new work or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) {
+      std::lock_guard<std::mutex> lock(mutex);
+      cv.notify_all();
+    }
+  }
+
+  // Consumer side: sleeps until hasWork() is true, notify() is called or the timeout expires
+  template <typename Predicate, typename Rep, typename Period>
+  void wait(Predicate hasWork, std::chrono::duration<Rep, Period> timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cv.wait_for(lock, timeout, hasWork);
+    waiting.store(false, std::memory_order_relaxed);
+  }
+
+  // Unconditional wake-up, e.g. for shutdown
+  void notifyAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cv.notify_all();
+  }
+
+private:
+  std::atomic<bool> waiting{false};
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+#endif
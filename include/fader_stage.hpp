@@ -0,0 +1,73 @@
+#ifndef FADER_STAGE_HPP
+#define FADER_STAGE_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Optional filter between fader input and the FaderCallback. Keeps only the latest value of
+// each fader and delivers it either right away, once per dispatched input batch, or at most
+// once per interval; values within the hysteresis band of the last delivered one are dropped
+// as pot jitter. Owned by the dispatching thread, so nothing here is synchronized.
+class FaderStage {
+public:
+  static constexpr int FADER_COUNT = 9;
+  static constexpr int FIRST_CONTROL = 48; // CC number of fader 0 (Track 1)
+
+  enum class Delivery {
+    IMMEDIATE, // Every value that passes the hysteresis check, as it arrives
+    PER_BATCH, // Latest value per fader after each batch of input
+    MAX_RATE   // Latest value per fader, at most once per minInterval
+  };
+
+  struct Config {
+    Delivery delivery = Delivery::IMMEDIATE;
+    std::chrono::microseconds minInterval{10000}; // MAX_RATE only
+    int hysteresis = 0; // Changes of this size or less are ignored; 0 and 127 always get through
+  };
+
+  void configure(const Config &newConfig);
+  const Config &getConfig() const { return config; }
+
+  // Records a value; returns true if it should be delivered now (IMMEDIATE mode)
+  bool submit(int fader, int value, std::int64_t nowNs);
+
+  // Calls deliver(fader, value) for every held value that is due
+  template <typename DeliverFn> std::size_t drain(std::int64_t nowNs, DeliverFn &&deliver) {
+    if (pendingCount == 0)
+      return 0;
+    std::size_t delivered = 0;
+    for (int fader = 0; fader < FADER_COUNT; fader++) {
+      auto &slot = slots[static_cast<std::size_t>(fader)];
+      if (!slot.pending || (config.delivery == Delivery::MAX_RATE && nowNs < slot.deliveredNs + intervalNs()))
+        continue;
+      slot.pending = false;
+      pendingCount--;
+      if (!accept(slot, slot.latest, nowNs))
+        continue;
+      deliver(fader, slot.latest);
+      delivered++;
+    }
+    return delivered;
+  }
+
+  // Time until drain() has something to deliver; a negative value if nothing is held
+  std::chrono::nanoseconds timeUntilDue(std::int64_t nowNs) const;
+
+private:
+  struct Slot {
+    int latest = 0;
+    int delivered = -1; // Nothing delivered yet
+    std::int64_t deliveredNs = 0;
+    bool pending = false;
+  };
+
+  Config config;
+  std::array<Slot, FADER_COUNT> slots{};
+  int pendingCount = 0;
+
+  std::int64_t intervalNs() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(config.minInterval).count(); }
+  bool accept(Slot &slot, int value, std::int64_t nowNs) const;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef GESTURE_RECOGNIZER_HPP
+#define GESTURE_RECOGNIZER_HPP
+
+#include "button_set.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Turns button presses and releases into long presses, double taps and chords. Fed and
+// polled by the dispatching thread, with fixed per-note state and no allocation.
+class GestureRecognizer {
+public:
+  struct Config {
+    std::chrono::milliseconds longPress{500}; // Held this long: LONG_PRESS, fired while still held
+    std::chrono::milliseconds doubleTap{300}; // Second press this soon after the first: DOUBLE_TAP
+    std::chrono::milliseconds chord{60};      // Presses this close together form a CHORD
+  };
+
+  struct Gesture {
+    enum class Type { LONG_PRESS, DOUBLE_TAP, CHORD };
+    Type type;
+    int note;            // The button, or the first button of a chord
+    ButtonSet buttons;   // The button, or every button of the chord
+    std::int64_t timeNs; // Steady clock
+  };
+
+  void configure(const Config &newConfig);
+  const Config &getConfig() const { return config; }
+
+  template <typename EmitFn> void onButton(int note, bool isPressed, std::int64_t nowNs, EmitFn &&emit) {
+    auto bit = ButtonSet::fromNote(note);
+    if (bit.empty())
+      return;
+    poll(nowNs, emit);
+    auto &state = notes[static_cast<std::size_t>(note)];
+
+    if (!isPressed) {
+      held = held.without(bit);
+      // A long press is not a tap
+      if (state.longFired)
+        state.lastTapNs = NEVER;
+      return;
+    }
+
+    held = held | bit;
+    state.pressNs = nowNs;
+    state.longFired = false;
+    if (state.lastTapNs != NEVER && nowNs - state.lastTapNs <= toNs(config.doubleTap)) {
+      state.lastTapNs = NEVER;
+      emit(Gesture{Gesture::Type::DOUBLE_TAP, note, bit, nowNs});
+    } else {
+      state.lastTapNs = nowNs;
+    }
+
+    if (chordMembers.empty()) {
+      chordStartNs = nowNs;
+      chordFirstNote = note;
+    }
+    chordMembers = chordMembers | bit;
+  }
+
+  // Fires gestures that depend only on time passing
+  template <typename EmitFn> void poll(std::int64_t nowNs, EmitFn &&emit) {
+    if (!chordMembers.empty() && nowNs - chordStartNs >= toNs(config.chord)) {
+      if (chordMembers.count() >= 2)
+        emit(Gesture{Gesture::Type::CHORD, chordFirstNote, chordMembers, nowNs});
+      chordMembers = {};
+    }
+    if (held.empty())
+      return;
+    held.forEachNote([&](int note) {
+      auto &state = notes[static_cast<std::size_t>(note)];
+      if (!state.longFired && nowNs - state.pressNs >= toNs(config.longPress)) {
+        state.longFired = true;
+        emit(Gesture{Gesture::Type::LONG_PRESS, note, ButtonSet::fromNote(note), nowNs});
+      }
+    });
+  }
+
+  // Time until poll() may fire something; negative if nothing is pending
+  std::chrono::nanoseconds timeUntilDue(std::int64_t nowNs) const;
+
+  ButtonSet heldButtons() const { return held; }
+
+private:
+  static constexpr std::int64_t NEVER = INT64_MIN;
+
+  struct NoteState {
+    std::int64_t pressNs = 0;
+    std::int64_t lastTapNs = NEVER;
+    bool longFired = false;
+  };
+
+  static constexpr std::int64_t toNs(std::chrono::milliseconds value) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
+  }
+
+  Config config;
+  std::array<NoteState, 128> notes{};
+  ButtonSet held;
+  ButtonSet chordMembers;
+  std::int64_t chordStartNs = 0;
+  int chordFirstNote = 0;
+};
+
+#endif
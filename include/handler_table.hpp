@@ -0,0 +1,56 @@
+#ifndef HANDLER_TABLE_HPP
+#define HANDLER_TABLE_HPP
+
+#include "apc_mini_controller.hpp"
+#include "button_set.hpp"
+#include "inplace_function.hpp"
+#include <array>
+#include <cstdint>
+
+// Button and fader handlers indexed by note and control number. Precedence is resolved when a
+// handler is registered (a note's own handler beats its button class handler), so dispatching
+// is one indexed load and an indirect call. Fill a table, then install it with
+// APCMiniController::setHandlers(); an installed table is never modified.
+class HandlerTable {
+public:
+  using ButtonType = APCMiniController::ButtonType;
+  using Fader = APCMiniController::Fader;
+  using ButtonHandler = InplaceFunction<void(int note, bool isPressed)>;
+  using FaderHandler = InplaceFunction<void(Fader fader, int value)>;
+
+  static constexpr int NOTE_COUNT = 128;
+  static constexpr int FADER_FIRST = 48;
+  static constexpr int FADER_COUNT = 9;
+
+  // One button; returns *this so registrations can be chained
+  HandlerTable &onButton(int note, ButtonHandler handler);
+  // Every button of a class that has no handler of its own
+  HandlerTable &onButtonType(ButtonType type, ButtonHandler handler);
+  HandlerTable &onFader(Fader fader, FaderHandler handler);
+  // Every fader that has no handler of its own
+  HandlerTable &onAnyFader(FaderHandler handler);
+
+  // Return false if nothing is registered for the note or control number
+  bool dispatchButton(int note, bool isPressed) const {
+    const auto &handler = buttons[static_cast<std::size_t>(note & 0x7F)];
+    if (!handler)
+      return false;
+    handler(note, isPressed);
+    return true;
+  }
+  bool dispatchFader(int controlNumber, int value) const {
+    auto slot = static_cast<unsigned>(controlNumber - FADER_FIRST);
+    if (slot >= FADER_COUNT || !faders[slot])
+      return false;
+    faders[slot](static_cast<Fader>(controlNumber), value);
+    return true;
+  }
+
+private:
+  std::array<ButtonHandler, NOTE_COUNT> buttons;
+  std::array<FaderHandler, FADER_COUNT> faders;
+  ButtonSet ownHandlers;           // Buttons registered with onButton()
+  std::uint32_t ownFaderMask = 0;  // Faders registered with onFader()
+};
+
+#endif
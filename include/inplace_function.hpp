@@ -0,0 +1,108 @@
+#ifndef INPLACE_FUNCTION_HPP
+#define INPLACE_FUNCTION_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, std::size_t Capacity = 32> class InplaceFunction;
+
+// Callable wrapper like std::function that never allocates: the target is stored in an inline
+// buffer of Capacity bytes and a target that does not fit fails to compile. Calling it is one
+// indirect call. Targets must be nothrow move constructible.
+template <typename R, typename... Args, std::size_t Capacity> class InplaceFunction<R(Args...), Capacity> {
+public:
+  InplaceFunction() = default;
+  InplaceFunction(std::nullptr_t) {}
+
+  template <typename F, typename Target = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same<Target, InplaceFunction>::value && std::is_invocable_r<R, Target &, Args...>::value>>
+  InplaceFunction(F &&target) {
+    static_assert(sizeof(Target) <= Capacity, "Callable too large for InplaceFunction; capture less or raise Capacity");
+    static_assert(alignof(Target) <= alignof(std::max_align_t), "Callable over-aligned for InplaceFunction");
+    static_assert(std::is_nothrow_move_constructible<Target>::value, "InplaceFunction targets must be nothrow movable");
+    ::new (static_cast<void *>(&storage)) Target(std::forward<F>(target));
+    invoker = &invoke<Target>;
+    manager = &manage<Target>;
+  }
+
+  InplaceFunction(const InplaceFunction &other) : invoker(other.invoker), manager(other.manager) {
+    if (manager)
+      manager(Operation::COPY, &storage, &other.storage);
+  }
+  InplaceFunction(InplaceFunction &&other) noexcept : invoker(other.invoker), manager(other.manager) {
+    if (manager)
+      manager(Operation::MOVE, &storage, &other.storage);
+    other.invoker = nullptr;
+    other.manager = nullptr;
+  }
+  ~InplaceFunction() { reset(); }
+
+  InplaceFunction &operator=(const InplaceFunction &other) {
+    if (this != &other) {
+      InplaceFunction copy(other);
+      *this = std::move(copy);
+    }
+    return *this;
+  }
+  InplaceFunction &operator=(InplaceFunction &&other) noexcept {
+    if (this != &other) {
+      reset();
+      invoker = other.invoker;
+      manager = other.manager;
+      if (manager)
+        manager(Operation::MOVE, &storage, &other.storage);
+      other.invoker = nullptr;
+      other.manager = nullptr;
+    }
+    return *this;
+  }
+  InplaceFunction &operator=(std::nullptr_t) {
+    reset();
+    return *this;
+  }
+
+  explicit operator bool() const { return invoker != nullptr; }
+
+  R operator()(Args... args) const { return invoker(&storage, std::forward<Args>(args)...); }
+
+private:
+  enum class Operation { COPY, MOVE, DESTROY };
+  using Storage = std::aligned_storage_t<Capacity, alignof(std::max_align_t)>;
+  using Invoker = R (*)(Storage *, Args &&...);
+  using Manager = void (*)(Operation, Storage *, Storage *);
+
+  template <typename Target> static R invoke(Storage *storage, Args &&...args) {
+    return (*std::launder(reinterpret_cast<Target *>(storage)))(std::forward<Args>(args)...);
+  }
+
+  // MOVE leaves the source destroyed, so a moved-from function is empty
+  template <typename Target> static void manage(Operation operation, Storage *destination, Storage *source) {
+    switch (operation) {
+    case Operation::COPY:
+      ::new (static_cast<void *>(destination)) Target(*std::launder(reinterpret_cast<const Target *>(source)));
+      break;
+    case Operation::MOVE:
+      ::new (static_cast<void *>(destination)) Target(std::move(*std::launder(reinterpret_cast<Target *>(source))));
+      std::launder(reinterpret_cast<Target *>(source))->~Target();
+      break;
+    case Operation::DESTROY:
+      std::launder(reinterpret_cast<Target *>(destination))->~Target();
+      break;
+    }
+  }
+
+  void reset() {
+    if (manager)
+      manager(Operation::DESTROY, &storage, nullptr);
+    invoker = nullptr;
+    manager = nullptr;
+  }
+
+  mutable Storage storage;
+  Invoker invoker = nullptr;
+  Manager manager = nullptr;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free histogram of durations with power-of-two nanosecond buckets: bucket i counts
+// samples in [2^i, 2^(i+1)) ns, bucket 0 also takes 0. record() is wait-free and can be
+// called from any thread while others take snapshots.
+class LatencyHistogram {
+public:
+  static constexpr std::size_t BUCKET_COUNT = 40; // Up to ~18 minutes
+
+  struct Snapshot {
+    std::array<std::uint64_t, BUCKET_COUNT> buckets{};
+    std::uint64_t count = 0; // Sum of the buckets
+    std::uint64_t sumNs = 0;
+    std::uint64_t maxNs = 0;
+
+    double meanNs() const { return count ? static_cast<double>(sumNs) / static_cast<double>(count) : 0.0; }
+    // Upper bound of the bucket holding the q-th quantile (q in [0, 1])
+    std::uint64_t percentileNs(double q) const;
+  };
+
+  void record(std::uint64_t ns) {
+    buckets[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ns, std::memory_order_relaxed);
+    auto currentMax = max.load(std::memory_order_relaxed);
+    while (ns > currentMax && !max.compare_exchange_weak(currentMax, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  Snapshot snapshot() const;
+  void reset();
+
+  static std::size_t bucketFor(std::uint64_t ns) {
+    std::size_t bucket = 0;
+    while (ns > 1 && bucket < BUCKET_COUNT - 1) {
+      ns >>= 1;
+      bucket++;
+    }
+    return bucket;
+  }
+
+private:
+  std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> buckets{};
+  std::atomic<std::uint64_t> sum{0};
+  std::atomic<std::uint64_t> max{0};
+};
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef LED_OUTPUT_PIPELINE_HPP
+#define LED_OUTPUT_PIPELINE_HPP
+
+#include "event_signal.hpp"
+#include "thread_policy.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// LED output for one APC Mini. Callers publish the desired value of a note with a couple of
+// atomic operations and never wait for I/O; one writer thread collects the notes marked since
+// its last pass (so only the latest value of each note is sent), skips the ones the device
+// already shows and writes the rest as a single running-status batch.
+class LedOutputPipeline {
+public:
+  static constexpr int NOTE_COUNT = 128;
+  static constexpr unsigned char UNKNOWN = 0xFF; // Device state not known, always resend
+  static constexpr std::size_t MAX_BATCH_BYTES = 1 + 2 * NOTE_COUNT;
+  static constexpr std::chrono::milliseconds MIN_RETRY_INTERVAL{10}; // After a failed write
+  static constexpr std::chrono::milliseconds MAX_RETRY_INTERVAL{1000};
+
+  // Writes messageCount note-on messages sharing one status byte; returns false if the write failed
+  using Writer = std::function<bool(const unsigned char *data, std::size_t size, std::size_t messageCount)>;
+
+  explicit LedOutputPipeline(Writer writer);
+  ~LedOutputPipeline();
+
+  // Writer thread, run under the given policy; stop() writes whatever is still pending before returning
+  void start(const ThreadPolicy &policy = {});
+  void stop();
+
+  // Lock-free, callable from any thread
+  void set(int note, unsigned char value);
+  // Between hold() and release() updates are staged and published together (nestable)
+  void hold();
+  void release();
+  // Forget what the device holds so the next write resends every LED
+  void invalidate();
+
+  // Writes everything pending on the calling thread, returns the number of messages sent. On a
+  // failed write the notes stay pending; the writer thread retries them with backoff.
+  std::size_t flush();
+  // Publishes these notes past any hold() and writes everything pending on the calling thread,
+  // for changes that must not wait for another thread's frame. False if the write failed.
+  bool writeNow(const unsigned char *notes, const unsigned char *newValues, std::size_t count);
+
+  static constexpr bool isLedNote(int note) { return (note >= 0 && note <= 71) || (note >= 82 && note <= 89); }
+
+private:
+  using NoteMask = std::array<std::atomic<std::uint64_t>, NOTE_COUNT / 64>;
+
+  Writer writer;
+  std::array<std::atomic<unsigned char>, NOTE_COUNT> values{};       // Published desired state
+  std::array<std::atomic<unsigned char>, NOTE_COUNT> stagedValues{}; // Written while held
+  NoteMask pending{};
+  NoteMask staged{};
+  std::atomic<int> holdDepth{0};
+  std::atomic<bool> resendAll{false};
+
+  std::mutex writeMutex; // Serializes the writer thread with flush()
+  std::array<unsigned char, NOTE_COUNT> sent{};
+  std::atomic<int> failedWrites{0}; // Consecutive
+
+  EventSignal signal;
+  std::unique_ptr<std::thread> writerThread;
+  std::atomic<bool> running{false};
+
+  void publishStaged();
+  bool hasPending() const;
+  std::size_t flushLocked(bool &ok);
+  void writerLoop();
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef LED_SCHEDULER_HPP
+#define LED_SCHEDULER_HPP
+
+#include "apc_mini_controller.hpp"
+#include "latency_histogram.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// LED changes scheduled for a point on the steady clock, e.g. to land on a beat. Pending
+// changes sit in a timer wheel of one-millisecond slots backed by a preallocated pool, so
+// scheduling and cancelling are O(1) and never allocate. A sender thread sleeps until the
+// earliest deadline, spins out the last stretch, and writes every change due at that moment
+// as one LED batch on its own thread. How late or early each send was against its deadline
+// is recorded.
+class LedScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Handle = std::uint64_t;
+  static constexpr Handle INVALID_HANDLE = 0;
+
+  static constexpr std::size_t WHEEL_SLOTS = 1024; // One millisecond each; later deadlines wait in an overflow list
+
+  struct Config {
+    std::size_t capacity = 4096;                  // Changes pending at once
+    std::chrono::microseconds spin{200};          // Busy-wait this close to a deadline instead of sleeping
+    std::chrono::microseconds batchWindow{50};    // Changes due this soon after a deadline go out with it
+  };
+
+  explicit LedScheduler(APCMiniController &controller) : LedScheduler(controller, Config{}) {}
+  LedScheduler(APCMiniController &controller, const Config &config);
+  ~LedScheduler();
+  LedScheduler(const LedScheduler &) = delete;
+  LedScheduler &operator=(const LedScheduler &) = delete;
+
+  void start();
+  // Pending changes are dropped
+  void stop();
+
+  // Return INVALID_HANDLE if the pool is full or the LED does not exist. A deadline in the
+  // past is sent at once.
+  Handle scheduleGridLED(int index, APCMiniController::LedColor color, Clock::time_point when);
+  Handle scheduleHorizontalLED(APCMiniController::HorizontalButton button, APCMiniController::RoundLedState state, Clock::time_point when);
+  Handle scheduleVerticalLED(APCMiniController::VerticalButton button, APCMiniController::RoundLedState state, Clock::time_point when);
+  // False if the change was already sent or cancelled
+  bool cancel(Handle handle);
+  std::size_t pendingCount() const;
+
+  struct Stats {
+    std::uint64_t scheduled = 0;
+    std::uint64_t sent = 0;
+    std::uint64_t cancelled = 0;
+    std::uint64_t rejected = 0; // Pool full
+    std::uint64_t failed = 0;   // Write refused by the device; retried by the LED output thread, untimed
+    std::uint64_t batches = 0;
+    LatencyHistogram::Snapshot lateness;  // Deadline to the change written to the device
+    LatencyHistogram::Snapshot earliness; // Changes written before their deadline, pulled in by batchWindow
+  };
+  Stats getStats() const;
+  void resetStats();
+
+private:
+  static constexpr std::uint32_t NIL = 0xFFFFFFFF;
+  static constexpr std::uint32_t OVERFLOW_LIST = WHEEL_SLOTS;
+
+  enum class Target : unsigned char { GRID, HORIZONTAL, VERTICAL };
+
+  struct Node {
+    std::int64_t deadlineNs = 0;
+    std::uint32_t previous = NIL;
+    std::uint32_t next = NIL;
+    std::uint32_t list = NIL; // Wheel slot, OVERFLOW_LIST, or NIL when free
+    std::uint32_t generation = 0;
+    Target target = Target::GRID;
+    unsigned char address = 0; // Grid index or button note
+    unsigned char value = 0;
+  };
+
+  struct Due {
+    std::int64_t deadlineNs;
+    Target target;
+    unsigned char address;
+    unsigned char value;
+  };
+
+  APCMiniController &controller;
+  Config config;
+
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<Node> pool;
+  std::uint32_t freeList = NIL;
+  std::array<std::uint32_t, WHEEL_SLOTS + 1> heads{}; // Wheel slots, then the overflow list
+  std::array<std::uint64_t, WHEEL_SLOTS / 64> occupied{};
+  std::int64_t baseTick = 0; // Earliest tick the wheel can hold; slots are tick % WHEEL_SLOTS
+  std::size_t pending = 0;
+  std::int64_t sleepingUntil = 0; // Deadline the sender waits for; an earlier schedule() wakes it
+  std::vector<Due> due; // Sender thread's batch, sized to the pool up front
+
+  std::unique_ptr<std::thread> senderThread;
+  bool running = false;
+
+  std::atomic<std::uint64_t> scheduled{0};
+  std::atomic<std::uint64_t> sent{0};
+  std::atomic<std::uint64_t> cancelled{0};
+  std::atomic<std::uint64_t> rejected{0};
+  std::atomic<std::uint64_t> failed{0};
+  std::atomic<std::uint64_t> batches{0};
+  LatencyHistogram lateness;
+  LatencyHistogram earliness;
+
+  Handle schedule(Target target, int address, unsigned char value, Clock::time_point when);
+  void link(std::uint32_t index);
+  void unlink(std::uint32_t index);
+  void release(std::uint32_t index);
+  void migrateOverflowLocked();
+  std::int64_t nextDeadlineLocked() const;
+  void collectDueLocked(std::int64_t nowNs);
+  static unsigned char noteOf(const Due &change);
+  void senderLoop();
+};
+
+#endif
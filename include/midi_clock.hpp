@@ -0,0 +1,61 @@
+#ifndef MIDI_CLOCK_HPP
+#define MIDI_CLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Tempo and beat phase recovered from MIDI system real-time messages (Clock at 24 pulses per
+// quarter note, Start, Continue, Stop). Pulse timestamps jitter by a millisecond or more over
+// USB, so an alpha-beta filter tracks the pulse period and phase; a jump of more than a pulse
+// re-seeds it. Fed by one thread, the transport input thread in APCMiniController; any
+// thread can read the position without locking.
+class MidiClock {
+public:
+  static constexpr int PULSES_PER_QUARTER = 24;
+  static constexpr int LOCK_PULSES = 24; // Consistent pulses before the estimate counts as locked
+  static constexpr int STALE_PULSES = 2; // Pulse periods without a pulse before it no longer does
+
+  static constexpr unsigned char CLOCK = 0xF8;
+  static constexpr unsigned char START = 0xFA;
+  static constexpr unsigned char CONTINUE = 0xFB;
+  static constexpr unsigned char STOP = 0xFC;
+
+  struct Position {
+    bool running = false;         // Between Start or Continue and Stop
+    bool locked = false;          // The tempo estimate has settled and pulses are still arriving
+    double bpm = 0;
+    double beats = 0;             // Quarter notes since Start, extrapolated to the time asked for
+    std::int64_t beatPeriodNs = 0;
+  };
+
+  static constexpr bool isRealtime(unsigned char status) { return status >= 0xF8; }
+
+  // Handles one real-time status byte; other real-time messages (active sensing, reset) are ignored
+  void feed(unsigned char status, std::int64_t timeNs);
+  // Lock-free; timeNs on the steady clock, as passed to feed()
+  Position position(std::int64_t timeNs) const;
+  std::uint64_t pulseCount() const { return pulsesReceived.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr double ALPHA = 0.2;  // Phase correction per pulse
+  static constexpr double BETA = 0.02;  // Period correction per pulse
+
+  // Input thread only
+  std::int64_t lastPulseNs = 0;   // Filtered
+  double periodNs = 0;
+  std::int64_t songPulses = -1;   // Pulses since Start; the first Clock after Start is pulse 0
+  int consistentPulses = 0;
+  bool running = false;
+
+  // Published state, behind a sequence counter (odd while being written)
+  std::atomic<std::uint64_t> sequence{0};
+  std::atomic<std::int64_t> publishedPulseNs{0};
+  std::atomic<std::int64_t> publishedPeriodNs{0};
+  std::atomic<std::int64_t> publishedSongPulses{-1};
+  std::atomic<std::uint32_t> publishedFlags{0};
+  std::atomic<std::uint64_t> pulsesReceived{0};
+
+  void publish();
+};
+
+#endif
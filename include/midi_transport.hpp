@@ -0,0 +1,31 @@
+#ifndef MIDI_TRANSPORT_HPP
+#define MIDI_TRANSPORT_HPP
+
+#include <cstddef>
+
+// Byte-level MIDI link to one device. APCMiniController only talks to hardware through
+// this interface, so the RtMidi backend can be replaced by an in-process one.
+class MidiTransport {
+public:
+  // Invoked on the transport's input thread for every incoming message
+  using InputHandler = void (*)(double timeStamp, const unsigned char *data, std::size_t size, void *userData);
+
+  virtual ~MidiTransport() = default;
+
+  virtual bool open() = 0;
+  virtual void close() = 0;
+  virtual bool isOpen() const = 0;
+  // Whether the device is currently attached, so a lost device can be told apart from a
+  // closed one and reopened when it comes back. Backends that cannot tell report true.
+  // APCMiniController calls it under the same lock as open(), close() and the sends.
+  virtual bool isAvailable() { return true; }
+
+  // Must be installed before open()
+  virtual void setInputHandler(InputHandler handler, void *userData) = 0;
+  virtual bool send(const unsigned char *data, std::size_t size) = 0;
+  // Several two-data-byte channel messages (note on/off, CC) in one buffer, running status
+  // allowed. The default sends them one by one for backends that take a message per call.
+  virtual bool sendBatch(const unsigned char *data, std::size_t size);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef PORT_WATCHER_HPP
+#define PORT_WATCHER_HPP
+
+#include "apc_mini_controller.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Polls the given controllers' ports on a background thread and lets each one drop and
+// restore its connection (APCMiniController::checkConnection()). Must be stopped before the
+// controllers are disconnected or destroyed.
+class PortWatcher {
+public:
+  static constexpr std::chrono::milliseconds DEFAULT_INTERVAL{500};
+
+  explicit PortWatcher(std::vector<APCMiniController *> controllers, std::chrono::milliseconds interval = DEFAULT_INTERVAL);
+  explicit PortWatcher(APCMiniController &controller, std::chrono::milliseconds interval = DEFAULT_INTERVAL);
+  ~PortWatcher();
+
+  void start();
+  void stop();
+  // One poll on the calling thread
+  void checkNow();
+
+private:
+  std::vector<APCMiniController *> controllers;
+  std::chrono::milliseconds interval;
+  std::unique_ptr<std::thread> watchThread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+
+  void watchLoop();
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef RTMIDI_TRANSPORT_HPP
+#define RTMIDI_TRANSPORT_HPP
+
+#include "midi_transport.hpp"
+#include <RtMidi.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Hardware backend: opens the RtMidi input and output port whose name contains portName.
+// With several units attached, matchIndex selects the n-th matching pair in port order.
+// Reopening prefers the exact ports used before, so a replugged unit keeps its identity.
+class RtMidiTransport : public MidiTransport {
+public:
+  explicit RtMidiTransport(std::string portName = "APC MINI", unsigned int matchIndex = 0);
+  ~RtMidiTransport() override;
+
+  bool open() override;
+  void close() override;
+  bool isOpen() const override { return midiIn && midiIn->isPortOpen(); }
+  bool isAvailable() override;
+
+  void setInputHandler(InputHandler handler, void *userData) override;
+  bool send(const unsigned char *data, std::size_t size) override;
+
+  // Number of devices that can be opened, i.e. matching input/output pairs
+  static unsigned int countPorts(const std::string &portName = "APC MINI");
+
+private:
+  std::string portName;
+  unsigned int matchIndex;
+  std::string inputName; // Names of the ports last opened
+  std::string outputName;
+  std::unique_ptr<RtMidiIn> midiIn;
+  std::unique_ptr<RtMidiOut> midiOut;
+  InputHandler inputHandler = nullptr;
+  void *inputUserData = nullptr;
+
+  static void rtMidiCallback(double timeStamp, std::vector<unsigned char> *message, void *userData);
+};
+
+#endif
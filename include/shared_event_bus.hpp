@@ -0,0 +1,98 @@
+#ifndef SHARED_EVENT_BUS_HPP
+#define SHARED_EVENT_BUS_HPP
+
+#include "apc_mini_controller.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct SharedBusLayout;
+
+// Publishes a controller's decoded button and fader events into a POSIX shared memory ring
+// that any number of local processes can follow (see SharedEventBusClient), and merges LED
+// writes from those processes into the device output. The ring is written by the dispatching
+// thread alone; readers take no locks and never slow it down. A reader that falls more than
+// a ring behind loses the oldest events and is told how many.
+class SharedEventBus : private APCMiniController::EventObserver {
+public:
+  static constexpr std::size_t DEFAULT_CAPACITY = 4096; // Events, rounded up to a power of two
+  static constexpr std::chrono::milliseconds DEFAULT_LED_INTERVAL{5};
+
+  // name is a shm_open name such as "/apc_mini". Returns nullptr (and reports why on
+  // std::cerr) if the segment cannot be created, including when the name is already taken
+  // by another live bus or another program; a bus left behind by a publisher that exited
+  // without cleaning up is removed and replaced. Create before connect(); destroy after
+  // disconnect() or on the dispatching thread.
+  static std::unique_ptr<SharedEventBus> create(APCMiniController &controller, const std::string &name,
+                                                std::size_t capacity = DEFAULT_CAPACITY,
+                                                std::chrono::milliseconds ledInterval = DEFAULT_LED_INTERVAL);
+  ~SharedEventBus() override;
+  SharedEventBus(const SharedEventBus &) = delete;
+  SharedEventBus &operator=(const SharedEventBus &) = delete;
+
+  std::uint64_t publishedCount() const;
+  // Applies pending LED writes from clients now; also done every ledInterval by the merge thread.
+  // Writes to notes without an LED or with values out of range are dropped.
+  std::size_t mergeLEDs();
+
+private:
+  SharedEventBus(APCMiniController &controller, std::string name, SharedBusLayout *layout, std::size_t mappedSize,
+                 std::size_t capacity, std::chrono::milliseconds ledInterval);
+
+  APCMiniController &controller;
+  std::string name;
+  SharedBusLayout *layout;
+  std::size_t mappedSize;
+  std::size_t ringSize; // Never re-read from the segment, which other processes can write
+  std::chrono::milliseconds ledInterval;
+
+  std::unique_ptr<std::thread> mergeThread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping = false;
+
+  void publish(APCMiniController::ControllerEvent::Kind kind, int number, int value);
+  void mergeLoop();
+  void onButton(int note, bool isPressed) override;
+  void onFader(int controlNumber, int value) override;
+};
+
+// A reader process's view of a SharedEventBus. Each client has its own cursor, starting at
+// the newest event when opened. Events are copied straight out of the shared ring.
+class SharedEventBusClient {
+public:
+  // Returns nullptr (and reports why on std::cerr) if no bus of that name exists
+  static std::unique_ptr<SharedEventBusClient> open(const std::string &name);
+  ~SharedEventBusClient();
+  SharedEventBusClient(const SharedEventBusClient &) = delete;
+  SharedEventBusClient &operator=(const SharedEventBusClient &) = delete;
+
+  // Copies up to capacity events published since the last call, returns the number copied
+  std::size_t read(APCMiniController::ControllerEvent *out, std::size_t capacity);
+  template <std::size_t N> std::size_t read(std::array<APCMiniController::ControllerEvent, N> &out) { return read(out.data(), N); }
+  // Events overwritten before this client read them
+  std::uint64_t lostEvents() const { return lost; }
+
+  // LED writes, merged into the device output by the publishing process. Values are as on the
+  // wire: LedColor for the grid, 0 off / 1 on / 2 blink for the round LEDs.
+  void setLED(int note, unsigned char value);
+  // The whole grid as one update (index 0 = top left, as setGridLED)
+  void setGrid(const std::array<APCMiniController::LedColor, 64> &colors);
+
+private:
+  SharedEventBusClient(SharedBusLayout *layout, std::size_t mappedSize, std::size_t capacity);
+
+  SharedBusLayout *layout;
+  std::size_t mappedSize;
+  std::size_t ringSize; // Validated at open(); never re-read from the segment
+  std::uint64_t cursor;
+  std::uint64_t lost = 0;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+// Bounded single-producer/single-consumer ring buffer of trivially copyable items.
+// push() and popBatch() never block or allocate; a full queue makes push() fail instead.
+template <typename T, std::size_t Capacity> class SpscQueue {
+  static_assert(std::is_trivially_copyable<T>::value, "SpscQueue items must be trivially copyable");
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+  // Producer side
+  bool push(const T &item) {
+    const std::size_t tail = writeIndex.load(std::memory_order_relaxed);
+    if (tail - cachedReadIndex == Capacity) {
+      cachedReadIndex = readIndex.load(std::memory_order_acquire);
+      if (tail - cachedReadIndex == Capacity)
+        return false;
+    }
+    slots[tail & MASK] = item;
+    writeIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side: moves up to maxItems into out, returns how many were taken
+  std::size_t popBatch(T *out, std::size_t maxItems) {
+    const std::size_t head = readIndex.load(std::memory_order_relaxed);
+    const std::size_t available = writeIndex.load(std::memory_order_acquire) - head;
+    const std::size_t count = available < maxItems ? available : maxItems;
+    for (std::size_t i = 0; i < count; i++) {
+      out[i] = slots[(head + i) & MASK];
+    }
+    readIndex.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  bool empty() const { return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire); }
+  std::size_t size() const { return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire); }
+  static constexpr std::size_t capacity() { return Capacity; }
+
+private:
+  static constexpr std::size_t MASK = Capacity - 1;
+
+  alignas(64) std::atomic<std::size_t> writeIndex{0};
+  std::size_t cachedReadIndex = 0; // Producer-local copy of readIndex
+  alignas(64) std::atomic<std::size_t> readIndex{0};
+  alignas(64) std::array<T, Capacity> slots{};
+};
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef THREAD_POLICY_HPP
+#define THREAD_POLICY_HPP
+
+#include <thread>
+
+// Where and how a latency-critical thread runs. The defaults leave the thread as it was created.
+struct ThreadPolicy {
+  int cpu = -1;     // Pin to this CPU; -1 = any
+  int priority = 0; // SCHED_FIFO priority 1-99; 0 = normal scheduling
+
+  bool isDefault() const { return cpu < 0 && priority <= 0; }
+};
+
+// Return false, with the reason on std::cerr, when the system refuses (SCHED_FIFO needs
+// CAP_SYS_NICE or an rtprio limit, locking needs a memlock limit). The thread or process
+// carries on unchanged in that case.
+bool applyThreadPolicy(std::thread &thread, const ThreadPolicy &policy, const char *name);
+bool applyThreadPolicy(const ThreadPolicy &policy, const char *name); // Calling thread
+// Locks every current and future page of the process into RAM, so no thread takes a page fault
+bool lockProcessMemory();
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef VIRTUAL_APC_MINI_HPP
+#define VIRTUAL_APC_MINI_HPP
+
+#include "midi_transport.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// In-process stand-in for an APC Mini. Device-side calls (pressButton, moveFader, ...) inject
+// input on the caller's thread. Timestamps are RtMidi-style deltas in seconds since the
+// previous message; a negative value measures the delta on the steady clock. Everything the controller
+// sends is decoded into per-note LED state and counted, so no hardware is needed.
+class VirtualApcMini : public MidiTransport {
+public:
+  bool open() override;
+  void close() override;
+  bool isOpen() const override { return openFlag.load(std::memory_order_acquire); }
+  bool isAvailable() override { return pluggedIn.load(std::memory_order_acquire); }
+
+  void setInputHandler(InputHandler handler, void *userData) override;
+  bool send(const unsigned char *data, std::size_t size) override;
+  // The decoder understands running status, so a batch arrives as one write like on a serial link
+  bool sendBatch(const unsigned char *data, std::size_t size) override { return send(data, size); }
+
+  // Device side: generate input as the hardware would
+  void pressButton(int note, double timeStamp = -1.0);
+  void releaseButton(int note, double timeStamp = -1.0);
+  void moveFader(int controlNumber, int value, double timeStamp = -1.0);
+  void inject(const unsigned char *data, std::size_t size, double timeStamp = -1.0);
+  // Simulates pulling the cable: sends are lost, open() fails and the LEDs go dark.
+  // The transport stays open as far as the controller can tell, like a real port does.
+  void unplug();
+  void plugIn();
+
+  // Output side: LED state as last written by the controller (note-on velocity, 0 = off)
+  unsigned char ledState(int note) const;
+  std::uint64_t sentMessageCount() const { return messagesReceived.load(std::memory_order_relaxed); }
+  std::uint64_t sentByteCount() const { return bytesReceived.load(std::memory_order_relaxed); }
+  void resetCounters();
+
+  // Keeps a copy of every raw send() buffer; off by default since it allocates
+  void setRecording(bool enabled);
+  std::vector<std::vector<unsigned char>> recordedSends() const;
+
+private:
+  std::atomic<bool> openFlag{false};
+  std::atomic<bool> pluggedIn{true};
+  InputHandler inputHandler = nullptr;
+  void *inputUserData = nullptr;
+  std::atomic<std::int64_t> lastInjectNs{0};
+
+  std::array<std::atomic<unsigned char>, 128> leds{};
+  std::atomic<std::uint64_t> messagesReceived{0};
+  std::atomic<std::uint64_t> bytesReceived{0};
+
+  mutable std::mutex recordMutex;
+  bool recording = false;
+  std::vector<std::vector<unsigned char>> recorded;
+};
+
+#endif
@@ -1,109 +1,241 @@
 #include "apc_mini_controller.hpp"
+#include "apc_mini_layout.hpp"
+#include "handler_table.hpp"
+#include "rtmidi_transport.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
-#include <map>
 #include <ostream>
+#include <stdexcept>
 
-const std::vector<std::vector<int>> APCMiniController::GRID_LAYOUT = {
-    {56, 57, 58, 59, 60, 61, 62, 63}, // Row 1 (Top)
-    {48, 49, 50, 51, 52, 53, 54, 55}, {40, 41, 42, 43, 44, 45, 46, 47}, {32, 33, 34, 35, 36, 37, 38, 39}, {24, 25, 26, 27, 28, 29, 30, 31},
-    {16, 17, 18, 19, 20, 21, 22, 23}, {8, 9, 10, 11, 12, 13, 14, 15},   {0, 1, 2, 3, 4, 5, 6, 7} // Row 8 (Bottom)
-};
+namespace {
 
-APCMiniController::APCMiniController() {
-  try {
-    midiIn = std::make_unique<RtMidiIn>();
-    midiOut = std::make_unique<RtMidiOut>();
-  } catch (RtMidiError &error) {
-    std::cerr << "RtMidi error: " << error.getMessage() << std::endl;
-    throw;
-  }
+std::int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
+// Sources further behind than this are treated as a stale anchor rather than real latency
+constexpr std::int64_t MAX_SOURCE_LAG_NS = 1000000000;
+
+} // namespace
+
+APCMiniController::APCMiniController() : APCMiniController(std::make_unique<RtMidiTransport>()) {}
+
+APCMiniController::APCMiniController(std::unique_ptr<MidiTransport> transport)
+    : transport(std::move(transport)), eventLog(std::cout),
+      ledOutput([this](const unsigned char *data, std::size_t size, std::size_t messageCount) {
+        return sendMidiMessages(data, size, messageCount);
+      }) {}
+
 APCMiniController::~APCMiniController() { disconnect(); }
 
-void APCMiniController::midiCallback(double, std::vector<unsigned char> *message, void *userData) {
+void APCMiniController::midiCallback(double timeStamp, const unsigned char *data, std::size_t size, void *userData) {
   auto controller = static_cast<APCMiniController *>(userData);
-  auto messageCopy = *message; // Copy the message
+  if (size == 0)
+    return;
+  if (controller->inputPolicyPending.load(std::memory_order_relaxed) && controller->inputPolicyPending.exchange(false))
+    applyThreadPolicy(controller->realtime.input, "MIDI input");
+
+  // Runs on the transport input thread: copy into a fixed-size event, never block or allocate
+  MidiEvent event{};
+  event.timeStamp = timeStamp;
+
+  // RtMidi timestamps are deltas since the previous message. Integrate them into a stream
+  // clock on the steady timeline; clamping keeps drift from running into the future.
+  auto now = steadyNowNs();
+  auto sourceTime = controller->lastSourceTimeNs + static_cast<std::int64_t>(timeStamp * 1e9);
+  if (sourceTime > now || sourceTime < now - MAX_SOURCE_LAG_NS)
+    sourceTime = now;
+  controller->lastSourceTimeNs = sourceTime;
+  if (auto *target = controller->capture.load(std::memory_order_acquire))
+    target->recordInbound(sourceTime, timeStamp, data, size);
+
+  // System real-time messages go straight to the clock and never take a queue slot
+  if (MidiClock::isRealtime(data[0])) {
+    controller->midiClock.feed(data[0], sourceTime);
+    controller->realtimeMessages.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
 
-  std::unique_lock<std::mutex> lock(controller->callbackMutex);
-  controller->pendingCallback = [controller, messageCopy]() { controller->handleMidiMessage(messageCopy); };
-  // std::cout << "Notifying from midiCallback" << std::endl;
-  controller->callbackCV.notify_one();
+  event.sourceTimeNs = sourceTime;
+  event.device = controller->deviceId;
+  event.size = static_cast<unsigned char>(std::min(size, sizeof(event.bytes)));
+  std::copy_n(data, event.size, event.bytes);
+
+  if (!controller->eventQueue.push(event)) {
+    controller->droppedEvents.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  controller->eventSignal->notify();
 }
 
 void APCMiniController::processCallback() {
-  // std::cout << "ProcessCallback Thread ID: " << std::this_thread::get_id() << std::endl;
-  while (isConnected()) {
-    {
-      std::unique_lock<std::mutex> lock(callbackMutex);
-      // std::cout << "Waiting with isConnected: " << isConnected() << std::endl;
-      if (callbackCV.wait_for(lock, std::chrono::seconds(1), [this]() { return pendingCallback != nullptr; })) {
-        // std::cout << "Callback received, executing" << std::endl;
-        pendingCallback();
-        pendingCallback = nullptr;
-      }
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  // Runs until disconnect(), not until the port closes, so a lost device can come back
+  while (active.load(std::memory_order_acquire)) {
+    if (dispatchPending() == 0)
+      eventSignal->wait([this]() { return hasPendingEvents() || !active.load(std::memory_order_acquire); },
+                        dispatchTimeout(std::chrono::seconds(1)));
   }
-  // std::cout << "ProcessCallback exiting" << std::endl;
 }
 
-bool APCMiniController::findAndOpenPorts() {
-  // Find APC Mini ports
-  int inputPort = -1, outputPort = -1;
-
-  for (unsigned int i = 0; i < midiIn->getPortCount(); i++) {
-    if (midiIn->getPortName(i).find("APC MINI") != std::string::npos) {
-      inputPort = i;
-      break;
-    }
+std::chrono::nanoseconds APCMiniController::dispatchTimeout(std::chrono::nanoseconds maxWait) const {
+  auto now = steadyNowNs();
+  for (auto due : {faderStage.timeUntilDue(now), gestures.timeUntilDue(now)}) {
+    if (due.count() >= 0 && due < maxWait)
+      maxWait = due;
   }
+  return maxWait;
+}
 
-  for (unsigned int i = 0; i < midiOut->getPortCount(); i++) {
-    if (midiOut->getPortName(i).find("APC MINI") != std::string::npos) {
-      outputPort = i;
-      break;
-    }
+void APCMiniController::runTimers() {
+  auto now = steadyNowNs();
+  // A full poll() buffer leaves held fader values in the stage for the next call
+  if (!pollOut || pollCapacity - pollCount >= FaderStage::FADER_COUNT)
+    faderStage.drain(now, [this, now](int fader, int value) { deliverFader(FaderStage::FIRST_CONTROL + fader, value, now); });
+  if (gestureCallback)
+    gestures.poll(now, [this](const Gesture &gesture) { deliverGesture(gesture); });
+}
+
+std::size_t APCMiniController::dispatchPending() {
+  std::size_t count = dispatchBatch(EVENT_BATCH_SIZE);
+  // Handler tables retired before this point are no longer in use
+  dispatchPasses.fetch_add(1, std::memory_order_seq_cst);
+  return count;
+}
+
+std::size_t APCMiniController::poll(ControllerEvent *out, std::size_t capacity) {
+  pollOut = out;
+  pollCapacity = capacity;
+  pollCount = 0;
+  // Every queued message yields at most one event, so pop no more than there is room for
+  while (pollCount < pollCapacity && dispatchBatch(std::min(pollCapacity - pollCount, EVENT_BATCH_SIZE)) > 0) {
   }
+  dispatchPasses.fetch_add(1, std::memory_order_seq_cst);
+  pollOut = nullptr;
+  return pollCount;
+}
 
-  if (inputPort == -1 || outputPort == -1) {
-    std::cerr << "APC Mini ports not found" << std::endl;
-    return false;
+std::size_t APCMiniController::dispatchBatch(std::size_t maxEvents) {
+  std::array<MidiEvent, EVENT_BATCH_SIZE> batch;
+  wakeRequested.store(false, std::memory_order_relaxed);
+  std::size_t count = eventQueue.popBatch(batch.data(), std::min(maxEvents, batch.size()));
+  if (count == 0) {
+    runTimers();
+    notifyDispatch();
+    return 0;
   }
 
-  try {
-    midiIn->openPort(inputPort);
-    midiOut->openPort(outputPort);
-    return true;
-  } catch (RtMidiError &error) {
-    std::cerr << "Error opening ports: " << error.getMessage() << std::endl;
-    return false;
+  eventsReceived.fetch_add(count, std::memory_order_relaxed);
+  if constexpr (EventLog::compiledIn(LogLevel::WARN)) {
+    auto drops = droppedEvents.load(std::memory_order_relaxed);
+    if (drops > reportedDrops) {
+      eventLog.write(LogLevel::WARN, EventLog::Kind::DROPPED, 0, 0, static_cast<std::uint32_t>(drops - reportedDrops));
+      reportedDrops = drops;
+    }
+  }
+  auto now = steadyNowNs();
+  for (std::size_t i = 0; i < count; i++) {
+    inputLatency.record(static_cast<std::uint64_t>(std::max<std::int64_t>(0, now - batch[i].sourceTimeNs)));
+    handleMidiMessage(batch[i]);
   }
+  runTimers();
+  notifyDispatch();
+  return count;
 }
 
-bool APCMiniController::connect() {
-  if (!findAndOpenPorts())
+bool APCMiniController::connect(DispatchMode mode, bool waitForDevice) {
+  if (!transport)
     return false;
+  if (active)
+    return !deviceLost;
 
-  // Set up callback thread first
-  callbackThread = std::make_unique<std::thread>(&APCMiniController::processCallback, this);
-
-  // Then set up MIDI callback
-  midiIn->setCallback(&midiCallback, this);
-  midiIn->ignoreTypes(false, false, false);
+  // Everything the input, dispatch and output paths use is allocated by now; locking first
+  // also keeps the stacks of the threads started below resident
+  if (realtimeEnabled && realtime.lockMemory)
+    lockProcessMemory();
+  inputPolicyPending = realtimeEnabled && !realtime.input.isDefault();
+  transport->setInputHandler(&midiCallback, this);
+  bool opened = transport->open();
+  if (!opened && !waitForDevice)
+    return false;
 
-  return true;
+  deviceLost = !opened;
+  active = true;
+  dispatchMode = mode;
+  if (mode != DispatchMode::POLLING) {
+    eventLog.start();
+    ledOutput.start(realtimeEnabled ? realtime.output : ThreadPolicy{});
+  }
+  if (mode == DispatchMode::OWN_THREAD) {
+    callbackThread = std::make_unique<std::thread>(&APCMiniController::processCallback, this);
+    if (realtimeEnabled)
+      applyThreadPolicy(*callbackThread, realtime.dispatch, "dispatch");
+  }
+  return opened;
 }
 
 void APCMiniController::disconnect() {
-  if (midiIn)
-    midiIn->closePort();
-  if (midiOut)
-    midiOut->closePort();
+  active = false;
+  // Writes out what is still pending, e.g. the lights being switched off at shutdown
+  ledOutput.stop();
+  if (dispatchMode == DispatchMode::POLLING)
+    ledOutput.flush(); // There was no writer thread to do it
+  if (transport) {
+    std::lock_guard<std::mutex> lock(transportMutex);
+    transport->close();
+  }
+  eventSignal->notifyAll();
   if (callbackThread && callbackThread->joinable()) {
     callbackThread->join();
   }
+  callbackThread.reset();
+  eventLog.stop();
+  if (dispatchMode == DispatchMode::POLLING)
+    drainLog();
+}
+
+bool APCMiniController::checkConnection() {
+  if (!active)
+    return false;
+  bool available;
+  {
+    // Enumerating ports uses the same RtMidi objects the LED output writes through
+    std::lock_guard<std::mutex> lock(transportMutex);
+    available = transport->isAvailable();
+  }
+
+  if (!deviceLost && !available) {
+    {
+      std::lock_guard<std::mutex> lock(transportMutex);
+      transport->close();
+    }
+    deviceLost = true;
+    std::cerr << "APC Mini disconnected" << std::endl;
+    if (connectionCallback)
+      connectionCallback(false);
+  } else if (deviceLost && available) {
+    auto start = steadyNowNs();
+    {
+      std::lock_guard<std::mutex> lock(transportMutex);
+      // A reopened port may deliver input on a new thread
+      inputPolicyPending = realtimeEnabled && !realtime.input.isDefault();
+      if (!active || !transport->open())
+        return false;
+    }
+    // The whole LED state goes out as one batch; if the output thread picks up the
+    // invalidation first, flush() waits for its write to finish
+    ledOutput.invalidate();
+    ledOutput.flush();
+    restoreTime.record(static_cast<std::uint64_t>(steadyNowNs() - start));
+    reconnects.fetch_add(1, std::memory_order_relaxed);
+    deviceLost = false;
+    std::cerr << "APC Mini reconnected" << std::endl;
+    if (connectionCallback)
+      connectionCallback(true);
+  }
+  return isConnected();
 }
 
 // In sync
@@ -112,111 +244,205 @@ void APCMiniController::disconnect() {
 //   controller->handleMidiMessage(*message);
 // }
 
-void APCMiniController::handleMidiMessage(const std::vector<unsigned char> &message) {
-  if (message.size() < 3)
+void APCMiniController::handleMidiMessage(const MidiEvent &event) {
+  if (event.size < 3)
     return;
 
-  unsigned char status = message[0] & 0xF0;
-  unsigned char data1 = message[1];
-  unsigned char data2 = message[2];
+  unsigned char status = event.bytes[0] & 0xF0;
+  unsigned char data1 = event.bytes[1];
+  unsigned char data2 = event.bytes[2];
 
   if (status == 0x90 || status == 0x80) {
+    const auto &info = ApcMiniLayout::noteInfo(data1);
+    if (!info.valid)
+      return;
     bool isPressed = (status == 0x90 && data2 > 0);
-    try {
-      ButtonType type = getButtonType(data1);
-      if (buttonCallback) {
-        buttonCallback(type, data1, isPressed);
-      }
-      // Add logging
-      std::cout << "Button: " << buttonTypeToString(type) << " [" << static_cast<int>(data1) << " " << getButtonName(data1) << "] "
-                << (isPressed ? "pressed" : "released") << std::endl;
-    } catch (const std::runtime_error &) {
+    // Updated before any callback runs, so callbacks see the press they are handling
+    auto bit = ButtonSet::fromNote(data1);
+    if (isPressed) {
+      pressedGrid.store(pressedGrid.load(std::memory_order_relaxed) | bit.grid, std::memory_order_relaxed);
+      pressedRound.store(pressedRound.load(std::memory_order_relaxed) | bit.round, std::memory_order_relaxed);
+    } else {
+      pressedGrid.store(pressedGrid.load(std::memory_order_relaxed) & ~bit.grid, std::memory_order_relaxed);
+      pressedRound.store(pressedRound.load(std::memory_order_relaxed) & ~bit.round, std::memory_order_relaxed);
     }
-  } else if (status == 0xB0 && data1 >= 48 && data1 <= 56) {
-    if (faderCallback) {
-      faderCallback(static_cast<Fader>(data1), data2);
+    if (pollOut)
+      pollOut[pollCount++] = {ControllerEvent::Kind::BUTTON, info.type, deviceId, data1, static_cast<unsigned char>(isPressed), event.sourceTimeNs};
+    const auto *table = handlers.load(std::memory_order_seq_cst);
+    if (buttonCallback || table) {
+      auto start = steadyNowNs();
+      if (buttonCallback)
+        buttonCallback(info.type, data1, isPressed);
+      if (table)
+        table->dispatchButton(data1, isPressed);
+      callbackTime.record(static_cast<std::uint64_t>(steadyNowNs() - start));
+    }
+    for (auto &slot : observers) {
+      if (auto *observer = slot.load(std::memory_order_acquire))
+        observer->onButton(data1, isPressed);
     }
-    // Add logging
-    std::cout << "Fader: (" << static_cast<int>(data1) << ") " << getFaderName(data1) << " = " << static_cast<int>(data2) << std::endl;
+    if constexpr (EventLog::compiledIn(LogLevel::INFO)) {
+      eventLog.write(LogLevel::INFO, EventLog::Kind::BUTTON, static_cast<unsigned char>(info.type), data1, isPressed);
+    }
+    if (gestureCallback)
+      gestures.onButton(data1, isPressed, event.sourceTimeNs, [this](const Gesture &gesture) { deliverGesture(gesture); });
+  } else if (status == 0xB0 && data1 >= 48 && data1 <= 56) {
+    faderUpdates.fetch_add(1, std::memory_order_relaxed);
+    if (faderStage.submit(data1 - FaderStage::FIRST_CONTROL, data2, event.sourceTimeNs))
+      deliverFader(data1, data2, event.sourceTimeNs);
+  } else if constexpr (EventLog::compiledIn(LogLevel::DEBUG)) {
+    eventLog.write(LogLevel::DEBUG, EventLog::Kind::UNHANDLED, event.bytes[0], data1, data2);
   }
 }
 
-void APCMiniController::sendMidiMessage(const std::vector<unsigned char> &message) {
-  if (!midiOut || !midiOut->isPortOpen())
-    return;
-  try {
-    midiOut->sendMessage(&message);
-  } catch (RtMidiError &error) {
-    std::cerr << "Error sending MIDI message: " << error.getMessage() << std::endl;
+void APCMiniController::deliverFader(int controlNumber, int value, std::int64_t timeNs) {
+  faderDeliveries.fetch_add(1, std::memory_order_relaxed);
+  if (pollOut)
+    pollOut[pollCount++] = {ControllerEvent::Kind::FADER, ButtonType::SPECIAL, deviceId, static_cast<unsigned char>(controlNumber),
+                            static_cast<unsigned char>(value), timeNs};
+  const auto *table = handlers.load(std::memory_order_seq_cst);
+  if (faderCallback || table) {
+    auto start = steadyNowNs();
+    if (faderCallback)
+      faderCallback(static_cast<Fader>(controlNumber), value);
+    if (table)
+      table->dispatchFader(controlNumber, value);
+    callbackTime.record(static_cast<std::uint64_t>(steadyNowNs() - start));
+  }
+  for (auto &slot : observers) {
+    if (auto *observer = slot.load(std::memory_order_acquire))
+      observer->onFader(controlNumber, value);
+  }
+  if constexpr (EventLog::compiledIn(LogLevel::INFO)) {
+    eventLog.write(LogLevel::INFO, EventLog::Kind::FADER, static_cast<unsigned char>(controlNumber), static_cast<unsigned char>(value));
   }
 }
 
+void APCMiniController::wake() {
+  wakeRequested.store(true, std::memory_order_release);
+  eventSignal->notify();
+}
+
+bool APCMiniController::addObserver(EventObserver *observer) {
+  for (auto &slot : observers) {
+    EventObserver *expected = nullptr;
+    if (slot.compare_exchange_strong(expected, observer))
+      return true;
+  }
+  return false;
+}
+
+void APCMiniController::removeObserver(EventObserver *observer) {
+  for (auto &slot : observers) {
+    EventObserver *expected = observer;
+    slot.compare_exchange_strong(expected, nullptr);
+  }
+}
+
+void APCMiniController::notifyDispatch() {
+  for (auto &slot : observers) {
+    if (auto *observer = slot.load(std::memory_order_acquire))
+      observer->onDispatch();
+  }
+}
+
+void APCMiniController::setHandlers(std::unique_ptr<HandlerTable> table) {
+  std::lock_guard<std::mutex> lock(handlerMutex);
+  // A dispatch pass that loaded the old pointer finishes after the pass count read here
+  handlers.store(table.get(), std::memory_order_seq_cst);
+  auto passes = dispatchPasses.load(std::memory_order_seq_cst);
+  retiredHandlers.erase(std::remove_if(retiredHandlers.begin(), retiredHandlers.end(),
+                                       [passes](const auto &retired) { return retired.second < passes; }),
+                        retiredHandlers.end());
+  if (installedHandlers)
+    retiredHandlers.emplace_back(std::move(installedHandlers), passes);
+  installedHandlers = std::move(table);
+}
+
+void APCMiniController::deliverGesture(const Gesture &gesture) {
+  auto start = steadyNowNs();
+  gestureCallback(gesture);
+  callbackTime.record(static_cast<std::uint64_t>(steadyNowNs() - start));
+}
+
+bool APCMiniController::sendMidiMessages(const unsigned char *data, std::size_t size, std::size_t messageCount) {
+  std::lock_guard<std::mutex> lock(transportMutex);
+  if (!transport || !transport->isOpen() || !transport->sendBatch(data, size))
+    return false;
+  messagesSent.fetch_add(messageCount, std::memory_order_relaxed);
+  bytesSent.fetch_add(size, std::memory_order_relaxed);
+  writeBatches.fetch_add(1, std::memory_order_relaxed);
+  if (auto *target = capture.load(std::memory_order_acquire))
+    target->recordOutbound(steadyNowNs(), data, size);
+  return true;
+}
+
+APCMiniController::Stats APCMiniController::getStats() const {
+  Stats stats;
+  stats.eventsReceived = eventsReceived.load(std::memory_order_relaxed);
+  stats.eventsDropped = droppedEvents.load(std::memory_order_relaxed);
+  stats.messagesSent = messagesSent.load(std::memory_order_relaxed);
+  stats.bytesSent = bytesSent.load(std::memory_order_relaxed);
+  stats.writeBatches = writeBatches.load(std::memory_order_relaxed);
+  stats.reconnects = reconnects.load(std::memory_order_relaxed);
+  stats.faderUpdates = faderUpdates.load(std::memory_order_relaxed);
+  stats.realtimeMessages = realtimeMessages.load(std::memory_order_relaxed);
+  stats.faderDeliveries = faderDeliveries.load(std::memory_order_relaxed);
+  stats.inputLatency = inputLatency.snapshot();
+  stats.callbackTime = callbackTime.snapshot();
+  stats.restoreTime = restoreTime.snapshot();
+  stats.takenAt = std::chrono::steady_clock::now();
+  return stats;
+}
+
+void APCMiniController::resetStats() {
+  eventsReceived.store(0, std::memory_order_relaxed);
+  droppedEvents.store(0, std::memory_order_relaxed);
+  messagesSent.store(0, std::memory_order_relaxed);
+  bytesSent.store(0, std::memory_order_relaxed);
+  writeBatches.store(0, std::memory_order_relaxed);
+  reconnects.store(0, std::memory_order_relaxed);
+  faderUpdates.store(0, std::memory_order_relaxed);
+  realtimeMessages.store(0, std::memory_order_relaxed);
+  faderDeliveries.store(0, std::memory_order_relaxed);
+  inputLatency.reset();
+  callbackTime.reset();
+  restoreTime.reset();
+}
+
+double APCMiniController::Stats::messagesPerSecond(const Stats &earlier, const Stats &later) {
+  double seconds = std::chrono::duration<double>(later.takenAt - earlier.takenAt).count();
+  return seconds > 0 ? static_cast<double>(later.messagesSent - earlier.messagesSent) / seconds : 0.0;
+}
+
+double APCMiniController::Stats::bytesPerSecond(const Stats &earlier, const Stats &later) {
+  double seconds = std::chrono::duration<double>(later.takenAt - earlier.takenAt).count();
+  return seconds > 0 ? static_cast<double>(later.bytesSent - earlier.bytesSent) / seconds : 0.0;
+}
+
 void APCMiniController::setGridLED(int index, LedColor color) {
   if (index < 0 || index > 63)
     return;
-  int row = index / 8;
-  int col = index % 8;
-  int note = GRID_LAYOUT[row][col];
-  sendMidiMessage({0x90, static_cast<unsigned char>(note), static_cast<unsigned char>(color)});
+  setLED(ApcMiniLayout::gridNote(index), static_cast<unsigned char>(color));
 }
 
 void APCMiniController::setHorizontalLED(HorizontalButton button, RoundLedState state) {
-  sendMidiMessage({0x90, static_cast<unsigned char>(button),
-                   static_cast<unsigned char>(state == RoundLedState::BLINK ? 2 : (state == RoundLedState::ON ? 1 : 0))});
+  setLED(static_cast<int>(button), static_cast<unsigned char>(state == RoundLedState::BLINK ? 2 : (state == RoundLedState::ON ? 1 : 0)));
 }
 
 void APCMiniController::setVerticalLED(VerticalButton button, RoundLedState state) {
-  sendMidiMessage({0x90, static_cast<unsigned char>(button),
-                   static_cast<unsigned char>(state == RoundLedState::BLINK ? 2 : (state == RoundLedState::ON ? 1 : 0))});
+  setLED(static_cast<int>(button), static_cast<unsigned char>(state == RoundLedState::BLINK ? 2 : (state == RoundLedState::ON ? 1 : 0)));
 }
 
 APCMiniController::ButtonType APCMiniController::getButtonType(int note) {
-  if (note >= 0 && note <= 63)
-    return ButtonType::GRID;
-  if (note >= 64 && note <= 71)
-    return ButtonType::HORIZONTAL;
-  if (note >= 82 && note <= 89)
-    return ButtonType::VERTICAL;
-  if (note == 98)
-    return ButtonType::SPECIAL;
-  throw std::runtime_error("Invalid note number");
-}
-
-std::string APCMiniController::buttonTypeToString(ButtonType type) {
-  switch (type) {
-  case ButtonType::GRID:
-    return "Grid";
-  case ButtonType::HORIZONTAL:
-    return "Horizontal";
-  case ButtonType::VERTICAL:
-    return "Vertical";
-  case ButtonType::SPECIAL:
-    return "Special";
-  default:
-    return "Unknown";
-  }
-}
-
-std::string APCMiniController::getButtonName(int note) {
-  if (note >= 0 && note <= 63) {
-    int row = note / 8;
-    int col = note % 8;
-    return "Grid[" + std::to_string(row) + "," + std::to_string(col) + "]";
-  }
-
-  static const std::map<int, std::string> buttonNames = {
-      {64, "Stop All"}, {65, "Left"},    {66, "Right"},   {67, "Up"},      {68, "Down"},    {69, "Volume"},
-      {70, "Pan"},      {71, "Send"},    {82, "Scene 1"}, {83, "Scene 2"}, {84, "Scene 3"}, {85, "Scene 4"},
-      {86, "Scene 5"},  {87, "Scene 6"}, {88, "Scene 7"}, {89, "Scene 8"}, {98, "Shift"}};
-
-  auto it = buttonNames.find(note);
-  return it != buttonNames.end() ? it->second : "Unknown";
-}
-
-std::string APCMiniController::getFaderName(int fader) {
-  if (fader == 56)
-    return "Master";
-  if (fader >= 48 && fader <= 55)
-    return "Track " + std::to_string(fader - 47);
-  return "Unknown Fader";
+  const auto &info = ApcMiniLayout::noteInfo(note);
+  if (!info.valid)
+    throw std::runtime_error("Invalid note number");
+  return info.type;
 }
+
+std::string_view APCMiniController::buttonTypeToString(ButtonType type) { return ApcMiniLayout::typeName(type); }
+
+std::string_view APCMiniController::getButtonName(int note) { return ApcMiniLayout::noteInfo(note).name; }
+
+std::string_view APCMiniController::getFaderName(int fader) { return ApcMiniLayout::faderName(fader); }
@@ -0,0 +1,32 @@
+#include "bitboard.hpp"
+
+void ColorPlanes::drawTo(GridFrame &frame, int tile) const {
+  int offset = tile * GridFrame::WIDTH;
+  for (int index = 0; index < GridFrame::SIZE; index++) {
+    auto bits = static_cast<unsigned char>(((green >> index) & 1) | (((red >> index) & 1) << 1) | (((blink >> index) & 1) << 2));
+    frame.set(index / 8, offset + index % 8, fromChannels(bits));
+  }
+}
+
+void ColorPlanes::drawLitTo(GridFrame &frame, int tile) const {
+  int offset = tile * GridFrame::WIDTH;
+  // Only the set bits are visited
+  for (auto bits = lit(); bits != 0; bits &= bits - 1) {
+    int index = ButtonSet::lowestBit(bits);
+    auto cell = static_cast<unsigned char>(((green >> index) & 1) | (((red >> index) & 1) << 1) | (((blink >> index) & 1) << 2));
+    frame.set(index / 8, offset + index % 8, fromChannels(cell));
+  }
+}
+
+ColorPlanes ColorPlanes::from(const GridFrame &frame, int tile) {
+  ColorPlanes planes;
+  int offset = tile * GridFrame::WIDTH;
+  for (int index = 0; index < GridFrame::SIZE; index++) {
+    auto bits = channels(frame.at(index / 8, offset + index % 8));
+    auto bit = std::uint64_t{1} << index;
+    planes.green |= (bits & GREEN_BIT) ? bit : 0;
+    planes.red |= (bits & RED_BIT) ? bit : 0;
+    planes.blink |= (bits & BLINK_BIT) ? bit : 0;
+  }
+  return planes;
+}
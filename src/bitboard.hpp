@@ -0,0 +1,174 @@
+#pragma once
+#include "button_set.hpp"
+#include "pattern.hpp"
+#include <cstdint>
+
+// Bit-parallel operations on one 8x8 tile held in a uint64_t, in the ButtonSet bit order:
+// bit row * 8 + col, row 0 at the top, col 0 on the left. A shift, mirror, rotation or a
+// whole Game of Life generation is a handful of word operations instead of a loop over 64
+// cells. Shifts drop what leaves the tile; scrolls wrap it around to the other side.
+class Bitboard {
+public:
+  static constexpr std::uint64_t EMPTY = 0;
+  static constexpr std::uint64_t FULL = ~std::uint64_t{0};
+  static constexpr std::uint64_t ROW = 0xFFull;                    // Row 0
+  static constexpr std::uint64_t COLUMN = 0x0101010101010101ull;   // Column 0
+  static constexpr std::uint64_t CHECKER = 0xAA55AA55AA55AA55ull;  // (row + col) even, top left lit
+
+  static constexpr std::uint64_t cell(int row, int col) { return std::uint64_t{1} << (row * 8 + col); }
+  static constexpr std::uint64_t rowMask(int row) { return ROW << (row * 8); }
+  static constexpr std::uint64_t columnMask(int col) { return COLUMN << col; }
+  // Columns first to first + count - 1 of every row
+  static constexpr std::uint64_t columnsMask(int first, int count) {
+    int end = first + count > 8 ? 8 : first + count;
+    return first >= end ? EMPTY : COLUMN * ((0xFFull >> (8 - (end - first))) << first);
+  }
+  // Rows and columns from 0 to 7; parts outside the tile are cut off
+  static constexpr std::uint64_t rectMask(int row, int col, int height, int width) {
+    std::uint64_t rows = height <= 0 ? EMPTY : (height >= 8 - row ? FULL : (std::uint64_t{1} << (height * 8)) - 1) << (row * 8);
+    return rows & columnsMask(col, width);
+  }
+  // The byte copied into every row: bit c lights column c from top to bottom, e.g. a counter as columns
+  static constexpr std::uint64_t spreadColumns(std::uint8_t columns) { return COLUMN * columns; }
+
+  static constexpr std::uint64_t shiftLeft(std::uint64_t bits, int n = 1) {
+    return n >= 8 ? EMPTY : (bits >> n) & columnsMask(0, 8 - n);
+  }
+  static constexpr std::uint64_t shiftRight(std::uint64_t bits, int n = 1) {
+    return n >= 8 ? EMPTY : (bits << n) & columnsMask(n, 8 - n);
+  }
+  static constexpr std::uint64_t shiftUp(std::uint64_t bits, int n = 1) { return n >= 8 ? EMPTY : bits >> (n * 8); }
+  static constexpr std::uint64_t shiftDown(std::uint64_t bits, int n = 1) { return n >= 8 ? EMPTY : bits << (n * 8); }
+
+  static constexpr std::uint64_t scrollLeft(std::uint64_t bits, int n = 1) {
+    n &= 7;
+    return n == 0 ? bits : shiftLeft(bits, n) | ((bits << (8 - n)) & columnsMask(8 - n, n));
+  }
+  static constexpr std::uint64_t scrollRight(std::uint64_t bits, int n = 1) { return scrollLeft(bits, 8 - (n & 7)); }
+  static constexpr std::uint64_t scrollUp(std::uint64_t bits, int n = 1) {
+    n &= 7;
+    return n == 0 ? bits : (bits >> (n * 8)) | (bits << (64 - n * 8));
+  }
+  static constexpr std::uint64_t scrollDown(std::uint64_t bits, int n = 1) { return scrollUp(bits, 8 - (n & 7)); }
+
+  static constexpr std::uint64_t invert(std::uint64_t bits) { return ~bits; }
+  // Left-right mirror: swaps bits inside every byte
+  static constexpr std::uint64_t mirror(std::uint64_t bits) {
+    bits = ((bits >> 1) & 0x5555555555555555ull) | ((bits & 0x5555555555555555ull) << 1);
+    bits = ((bits >> 2) & 0x3333333333333333ull) | ((bits & 0x3333333333333333ull) << 2);
+    return ((bits >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((bits & 0x0F0F0F0F0F0F0F0Full) << 4);
+  }
+  // Top-bottom flip: reverses the bytes
+  static constexpr std::uint64_t flip(std::uint64_t bits) {
+    bits = ((bits >> 8) & 0x00FF00FF00FF00FFull) | ((bits & 0x00FF00FF00FF00FFull) << 8);
+    bits = ((bits >> 16) & 0x0000FFFF0000FFFFull) | ((bits & 0x0000FFFF0000FFFFull) << 16);
+    return (bits >> 32) | (bits << 32);
+  }
+  // Rows become columns: (row, col) moves to (col, row)
+  static constexpr std::uint64_t transpose(std::uint64_t bits) {
+    std::uint64_t t = 0x0F0F0F0F00000000ull & (bits ^ (bits << 28));
+    bits ^= t ^ (t >> 28);
+    t = 0x3333000033330000ull & (bits ^ (bits << 14));
+    bits ^= t ^ (t >> 14);
+    t = 0x5500550055005500ull & (bits ^ (bits << 7));
+    return bits ^ t ^ (t >> 7);
+  }
+  static constexpr std::uint64_t rotateClockwise(std::uint64_t bits) { return mirror(transpose(bits)); }
+  static constexpr std::uint64_t rotateCounterClockwise(std::uint64_t bits) { return flip(transpose(bits)); }
+  static constexpr std::uint64_t rotate180(std::uint64_t bits) { return flip(mirror(bits)); }
+
+  // One Game of Life generation (born with 3 neighbours, survives with 2 or 3). The neighbour
+  // counts of all 64 cells are summed at once in three bit planes; with wrap the tile is a torus.
+  static constexpr std::uint64_t lifeStep(std::uint64_t bits, bool wrap = true) {
+    std::uint64_t left = wrap ? scrollLeft(bits) : shiftLeft(bits);
+    std::uint64_t right = wrap ? scrollRight(bits) : shiftRight(bits);
+    const std::uint64_t rows[3] = {left, bits, right};
+    std::uint64_t ones = 0, twos = 0, fourPlus = 0;
+    for (int i = 0; i < 3; i++) {
+      std::uint64_t up = wrap ? scrollUp(rows[i]) : shiftUp(rows[i]);
+      std::uint64_t down = wrap ? scrollDown(rows[i]) : shiftDown(rows[i]);
+      for (std::uint64_t neighbour : {up, i == 1 ? EMPTY : rows[i], down}) {
+        std::uint64_t carry = ones & neighbour;
+        ones ^= neighbour;
+        fourPlus |= twos & carry;
+        twos ^= carry;
+      }
+    }
+    return ~fourPlus & twos & (ones | bits);
+  }
+
+  static constexpr int count(std::uint64_t bits) { return ButtonSet::popcount(bits); }
+};
+
+static_assert(Bitboard::transpose(Bitboard::cell(0, 7)) == Bitboard::cell(7, 0) && Bitboard::mirror(Bitboard::COLUMN) == Bitboard::columnMask(7));
+static_assert(Bitboard::rotateClockwise(Bitboard::cell(0, 0)) == Bitboard::cell(0, 7) &&
+              Bitboard::rotateCounterClockwise(Bitboard::cell(0, 0)) == Bitboard::cell(7, 0));
+static_assert(Bitboard::scrollLeft(Bitboard::cell(3, 0)) == Bitboard::cell(3, 7) && Bitboard::shiftLeft(Bitboard::cell(3, 0)) == 0);
+static_assert(Bitboard::scrollUp(Bitboard::cell(0, 2), 2) == Bitboard::cell(6, 2) && Bitboard::flip(Bitboard::ROW) == Bitboard::rowMask(7));
+static_assert(Bitboard::spreadColumns(0x05) == (Bitboard::columnMask(0) | Bitboard::columnMask(2)));
+static_assert(Bitboard::rectMask(1, 1, 6, 6) == 0x007E7E7E7E7E7E00ull && Bitboard::columnsMask(6, 4) == Bitboard::columnsMask(6, 2));
+// A blinker oscillates, a block stays put
+static_assert(Bitboard::lifeStep(Bitboard::rectMask(3, 2, 1, 3)) == Bitboard::rectMask(2, 3, 3, 1));
+static_assert(Bitboard::lifeStep(Bitboard::rectMask(0, 0, 2, 2), false) == Bitboard::rectMask(0, 0, 2, 2));
+
+// A tile as three bitboards, one per LED channel: yellow is green and red together, and any
+// lit cell blinks when its blink bit is set. Blink bits under unlit cells mean nothing.
+struct ColorPlanes {
+  using LedColor = APCMiniController::LedColor;
+  static constexpr unsigned char GREEN_BIT = 1, RED_BIT = 2, BLINK_BIT = 4;
+
+  std::uint64_t green = 0;
+  std::uint64_t red = 0;
+  std::uint64_t blink = 0;
+
+  // Bitboard lit in one color
+  static constexpr ColorPlanes of(std::uint64_t bits, LedColor color) {
+    auto bitsOf = [bits](bool on) { return on ? bits : Bitboard::EMPTY; };
+    unsigned char c = channels(color);
+    return {bitsOf(c & GREEN_BIT), bitsOf(c & RED_BIT), bitsOf(c & BLINK_BIT)};
+  }
+  // Channels add up, as BlendMode::MIX
+  constexpr ColorPlanes operator|(const ColorPlanes &other) const { return {green | other.green, red | other.red, blink | other.blink}; }
+  // Other is drawn over this wherever it is lit, as BlendMode::OVER
+  constexpr ColorPlanes over(const ColorPlanes &other) const {
+    std::uint64_t covered = other.lit();
+    return {(green & ~covered) | other.green, (red & ~covered) | other.red, (blink & ~covered) | other.blink};
+  }
+  constexpr std::uint64_t lit() const { return green | red; }
+  constexpr bool operator==(const ColorPlanes &other) const { return green == other.green && red == other.red && blink == other.blink; }
+
+  // Writes all 64 cells of a tile, or only the lit ones
+  void drawTo(GridFrame &frame, int tile = 0) const;
+  void drawLitTo(GridFrame &frame, int tile = 0) const;
+  static ColorPlanes from(const GridFrame &frame, int tile = 0);
+
+  static constexpr unsigned char channels(LedColor color) {
+    switch (color) {
+    case LedColor::GREEN:
+      return GREEN_BIT;
+    case LedColor::GREEN_BLINK:
+      return GREEN_BIT | BLINK_BIT;
+    case LedColor::RED:
+      return RED_BIT;
+    case LedColor::RED_BLINK:
+      return RED_BIT | BLINK_BIT;
+    case LedColor::YELLOW:
+      return GREEN_BIT | RED_BIT;
+    case LedColor::YELLOW_BLINK:
+      return GREEN_BIT | RED_BIT | BLINK_BIT;
+    case LedColor::OFF:
+      break;
+    }
+    return 0;
+  }
+  static constexpr LedColor fromChannels(unsigned char bits) {
+    constexpr LedColor TABLE[8] = {LedColor::OFF, LedColor::GREEN,       LedColor::RED,       LedColor::YELLOW,
+                                   LedColor::OFF, LedColor::GREEN_BLINK, LedColor::RED_BLINK, LedColor::YELLOW_BLINK};
+    return TABLE[bits & 7];
+  }
+};
+
+static_assert(ColorPlanes::fromChannels(ColorPlanes::channels(ColorPlanes::LedColor::GREEN) | ColorPlanes::channels(ColorPlanes::LedColor::RED)) ==
+              ColorPlanes::LedColor::YELLOW);
+static_assert((ColorPlanes::of(1, ColorPlanes::LedColor::YELLOW).over(ColorPlanes::of(1, ColorPlanes::LedColor::RED_BLINK))) ==
+              ColorPlanes::of(1, ColorPlanes::LedColor::RED_BLINK));
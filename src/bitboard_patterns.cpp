@@ -0,0 +1,83 @@
+#include "bitboard_patterns.hpp"
+#include "glyph_font.hpp"
+#include <algorithm>
+
+MarqueePattern::MarqueePattern(std::string_view text, LedColor color, std::chrono::milliseconds step, int row)
+    : color(color), step(step), row(std::clamp(row, 0, GridFrame::HEIGHT - GlyphFont::HEIGHT)) {
+  setText(text);
+}
+
+void MarqueePattern::setText(std::string_view text) {
+  std::lock_guard<std::mutex> lock(mutex);
+  length = 0;
+  for (char c : text) {
+    const auto &glyph = GlyphFont::glyph(c);
+    if (length + static_cast<std::size_t>(glyph.width) + 1 > MAX_COLUMNS)
+      break;
+    for (int col = 0; col < glyph.width; col++) {
+      columns[length++] = glyph.columns[static_cast<std::size_t>(col)];
+    }
+    columns[length++] = 0; // Spacing
+  }
+}
+
+void MarqueePattern::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  position = 0;
+}
+
+// The canvas width of blank columns comes first, so the text enters from the right edge
+std::uint8_t MarqueePattern::columnAt(std::size_t index, int width) const {
+  auto lead = static_cast<std::size_t>(width);
+  return (index >= lead && index - lead < length) ? columns[index - lead] : 0;
+}
+
+void MarqueePattern::render(GridFrame &frame, FrameContext &) {
+  std::lock_guard<std::mutex> lock(mutex);
+  position %= length + static_cast<std::size_t>(frame.width);
+  for (int tile = 0; tile < frame.tiles(); tile++) {
+    // Column c of the window becomes byte c, i.e. row c, and the transpose stands it upright
+    std::uint64_t sideways = 0;
+    auto first = position + static_cast<std::size_t>(tile * GridFrame::WIDTH);
+    for (int col = 0; col < GridFrame::WIDTH; col++) {
+      sideways |= std::uint64_t{columnAt(first + static_cast<std::size_t>(col), frame.width)} << (col * 8);
+    }
+    ColorPlanes::of(Bitboard::shiftDown(Bitboard::transpose(sideways), row), color).drawTo(frame, tile);
+  }
+  position++;
+}
+
+LifePattern::LifePattern(LedColor color, int densityPercent) : color(color), density(std::clamp(densityPercent, 1, 100)) { reset(); }
+
+void LifePattern::reset() {
+  boards.fill(0);
+  previous.fill(0);
+  staleFrames.fill(STALE_FRAMES);
+}
+
+std::uint64_t LifePattern::seed(std::mt19937 &rng) const {
+  std::uniform_int_distribution<int> percent{0, 99};
+  std::uint64_t board = 0;
+  for (int index = 0; index < GridFrame::SIZE; index++) {
+    if (percent(rng) < density)
+      board |= std::uint64_t{1} << index;
+  }
+  return board;
+}
+
+void LifePattern::render(GridFrame &frame, FrameContext &context) {
+  for (int tile = 0; tile < frame.tiles(); tile++) {
+    auto t = static_cast<std::size_t>(tile);
+    if (staleFrames[t] >= STALE_FRAMES) {
+      boards[t] = seed(context.rng);
+      previous[t] = 0;
+      staleFrames[t] = 0;
+    } else {
+      auto next = Bitboard::lifeStep(boards[t]);
+      staleFrames[t] = (next == boards[t] || next == previous[t]) ? staleFrames[t] + 1 : 0;
+      previous[t] = boards[t];
+      boards[t] = next;
+    }
+    ColorPlanes::of(boards[t], color).drawTo(frame, tile);
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "bitboard.hpp"
+#include "pattern.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+// Scrolls text right to left across the whole canvas in the GlyphFont, e.g. the tempo, a scene
+// name or a counter. setText() turns the text into glyph columns once, so a frame is eight
+// column loads and a transpose per device.
+class MarqueePattern : public Pattern {
+public:
+  using LedColor = APCMiniController::LedColor;
+  static constexpr std::size_t MAX_COLUMNS = 256; // Longer text is cut off
+
+  // row is the top row of the 5 pixel high text, 0 to 3
+  explicit MarqueePattern(std::string_view text = {}, LedColor color = LedColor::GREEN,
+                          std::chrono::milliseconds step = std::chrono::milliseconds(80), int row = 1);
+
+  // Callable from any thread while the pattern runs. The scroll position is kept, so text
+  // that changes every few frames (a counter, the tempo) updates in place.
+  void setText(std::string_view text);
+
+  void reset() override;
+  void render(GridFrame &frame, FrameContext &context) override;
+  std::chrono::milliseconds period() const override { return step; }
+
+private:
+  std::mutex mutex; // Guards the columns against setText()
+  std::array<std::uint8_t, MAX_COLUMNS> columns{};
+  std::size_t length = 0;
+  std::size_t position = 0;
+  LedColor color;
+  std::chrono::milliseconds step;
+  int row;
+
+  std::uint8_t columnAt(std::size_t index, int width) const;
+};
+
+// Conway's Game of Life on every device, each tile its own torus, one Bitboard::lifeStep()
+// per frame. A tile that dies out or settles into a still life or blinker is reseeded.
+class LifePattern : public Pattern {
+public:
+  using LedColor = APCMiniController::LedColor;
+
+  explicit LifePattern(LedColor color = LedColor::GREEN, int densityPercent = 35);
+
+  void reset() override;
+  void render(GridFrame &frame, FrameContext &context) override;
+
+private:
+  static constexpr int STALE_FRAMES = 8; // Shown before reseeding
+
+  std::array<std::uint64_t, GridFrame::MAX_TILES> boards{};
+  std::array<std::uint64_t, GridFrame::MAX_TILES> previous{};
+  std::array<int, GridFrame::MAX_TILES> staleFrames{};
+  LedColor color;
+  int density;
+
+  std::uint64_t seed(std::mt19937 &rng) const;
+};
@@ -0,0 +1,206 @@
+#include "builtin_patterns.hpp"
+#include "bitboard.hpp"
+#include <array>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+using LedColor = APCMiniController::LedColor;
+
+const std::vector<std::pair<int, int>> SPIRAL_PATH = {
+    {3, 3}, {3, 4}, {4, 4}, {4, 3}, {3, 2}, {2, 2}, {2, 3}, {2, 4}, {2, 5}, {3, 5}, {4, 5}, {5, 5}, {5, 4}, {5, 3}, {5, 2}, {5, 1},
+    {4, 1}, {3, 1}, {2, 1}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 5}, {1, 6}, {2, 6}, {3, 6}, {4, 6}, {5, 6}, {6, 6}, {6, 5}, {6, 4},
+    {6, 3}, {6, 2}, {6, 1}, {6, 0}, {5, 0}, {4, 0}, {3, 0}, {2, 0}, {1, 0}, {0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}, {0, 6},
+    {0, 7}, {1, 7}, {2, 7}, {3, 7}, {4, 7}, {5, 7}, {6, 7}, {7, 7}, {7, 6}, {7, 5}, {7, 4}, {7, 3}, {7, 2}, {7, 1}, {7, 0}};
+
+// Cells with (row + col) % 3 == k, for the color wave
+constexpr std::array<std::uint64_t, 3> buildDiagonals() {
+  std::array<std::uint64_t, 3> diagonals{};
+  for (int index = 0; index < GridFrame::SIZE; index++) {
+    diagonals[static_cast<std::size_t>((index / 8 + index % 8) % 3)] |= std::uint64_t{1} << index;
+  }
+  return diagonals;
+}
+constexpr auto DIAGONALS = buildDiagonals();
+
+// Outline of the square of the given size around (3, 3), for the expanding square
+constexpr std::uint64_t ring(int size) {
+  return Bitboard::rectMask(3 - size, 3 - size, 2 * size + 1, 2 * size + 1) & ~Bitboard::rectMask(4 - size, 4 - size, 2 * size - 1, 2 * size - 1);
+}
+constexpr std::array<std::uint64_t, 4> RINGS = {ring(0), ring(1), ring(2), ring(3)};
+static_assert(RINGS[0] == Bitboard::cell(3, 3) && Bitboard::count(RINGS[3]) == 24);
+
+// Single blinking cell running through the grid
+class SnakePattern : public Pattern {
+public:
+  void reset() override { pos = 0; }
+  void render(GridFrame &frame, FrameContext &) override {
+    frame.fill(LedColor::OFF);
+    pos %= frame.size();
+    frame[pos] = LedColor::GREEN_BLINK;
+    pos = (pos + 1) % frame.size();
+  }
+
+private:
+  int pos = 0;
+};
+
+// Drops start at random columns and fall to the bottom, leaving a trail
+class RainfallPattern : public Pattern {
+public:
+  void reset() override { drops.fill(-1); }
+  RainfallPattern() { reset(); }
+  void render(GridFrame &frame, FrameContext &context) override {
+    for (int col = 0; col < frame.width; col++) {
+      auto &drop = drops[static_cast<std::size_t>(col)];
+      if (drop == -1 && dist(context.rng) == 0) {
+        drop = 0;
+      }
+      if (drop >= 0) {
+        frame.set(drop, col, LedColor::YELLOW_BLINK);
+        drop++;
+        if (drop >= 8)
+          drop = -1;
+      }
+    }
+  }
+
+private:
+  std::array<int, GridFrame::MAX_WIDTH> drops;
+  std::uniform_int_distribution<> dist{0, 7};
+};
+
+// Diagonal green/red/yellow bands moving across the grid
+class ColorWavePattern : public Pattern {
+public:
+  void reset() override { wave = 0; }
+  void render(GridFrame &frame, FrameContext &) override {
+    static constexpr LedColor PHASES[3] = {LedColor::GREEN, LedColor::RED, LedColor::YELLOW};
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      int shift = tile * GridFrame::WIDTH + wave;
+      ColorPlanes planes;
+      for (std::size_t k = 0; k < DIAGONALS.size(); k++) {
+        planes = planes | ColorPlanes::of(DIAGONALS[k], PHASES[(static_cast<int>(k) + shift) % 3]);
+      }
+      planes.drawTo(frame, tile);
+    }
+    wave = (wave + 1) % 16;
+  }
+
+private:
+  int wave = 0;
+};
+
+// Rings growing out of the center of every device
+class ExpandingSquarePattern : public Pattern {
+public:
+  void reset() override { size = 0; }
+  void render(GridFrame &frame, FrameContext &) override {
+    auto planes = ColorPlanes::of(RINGS[static_cast<std::size_t>(size)], LedColor::RED_BLINK);
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      planes.drawLitTo(frame, tile);
+    }
+    size = (size + 1) % 4;
+  }
+
+private:
+  int size = 0;
+};
+
+// Random blinking cells appearing and fading out
+class SparklePattern : public Pattern {
+public:
+  void render(GridFrame &frame, FrameContext &context) override {
+    static constexpr LedColor COLORS[3] = {LedColor::GREEN_BLINK, LedColor::RED_BLINK, LedColor::YELLOW_BLINK};
+    // Same density on every device
+    std::uniform_int_distribution<> posDist{0, frame.size() - 1};
+    for (int i = 0; i < 5 * frame.tiles(); i++) {
+      int pos = posDist(context.rng);
+      frame[pos] = COLORS[colorDist(context.rng)];
+    }
+    for (int i = 0; i < 3 * frame.tiles(); i++) {
+      frame[posDist(context.rng)] = LedColor::OFF;
+    }
+  }
+
+private:
+  std::uniform_int_distribution<> colorDist{0, 2};
+};
+
+// Alternating green/red checkerboard
+class CheckerboardPattern : public Pattern {
+public:
+  void reset() override { alternate = false; }
+  void render(GridFrame &frame, FrameContext &) override {
+    // Tiles are an even number of columns wide, so every tile starts on an even square
+    auto green = alternate ? Bitboard::invert(Bitboard::CHECKER) : Bitboard::CHECKER;
+    ColorPlanes planes{green, Bitboard::invert(green), 0};
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      planes.drawTo(frame, tile);
+    }
+    alternate = !alternate;
+  }
+
+private:
+  bool alternate = false;
+};
+
+// Traces a spiral from the center outwards on every device
+class SpiralPattern : public Pattern {
+public:
+  void reset() override { currentPos = 0; }
+  void render(GridFrame &frame, FrameContext &) override {
+    const auto &pos = SPIRAL_PATH[currentPos];
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      frame.set(pos.first, tile * GridFrame::WIDTH + pos.second, LedColor::YELLOW_BLINK);
+    }
+    currentPos = (currentPos + 1) % SPIRAL_PATH.size();
+  }
+
+private:
+  std::size_t currentPos = 0;
+};
+
+// Lights the columns of a counter with one bit per column
+class BinaryCounterPattern : public Pattern {
+public:
+  void reset() override { count = 0; }
+  void render(GridFrame &frame, FrameContext &) override {
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      auto columns = static_cast<std::uint8_t>(count >> (tile * GridFrame::WIDTH));
+      ColorPlanes::of(Bitboard::spreadColumns(columns), LedColor::GREEN).drawLitTo(frame, tile);
+    }
+    count = (count + 1) & ((std::uint64_t{1} << frame.width) - 1);
+  }
+
+private:
+  std::uint64_t count = 0;
+};
+
+} // namespace
+
+std::unique_ptr<Pattern> makeBuiltinPattern(int note) {
+  switch (note) {
+  case 64:
+    return std::make_unique<SnakePattern>();
+  case 65:
+    return std::make_unique<RainfallPattern>();
+  case 66:
+    return std::make_unique<ColorWavePattern>();
+  case 67:
+    return std::make_unique<ExpandingSquarePattern>();
+  case 68:
+    return std::make_unique<SparklePattern>();
+  case 69:
+    return std::make_unique<CheckerboardPattern>();
+  case 70:
+    return std::make_unique<SpiralPattern>();
+  case 71:
+    return std::make_unique<BinaryCounterPattern>();
+  default:
+    return nullptr;
+  }
+}
+
+std::vector<int> builtinPatternIds() { return {64, 65, 66, 67, 68, 69, 70, 71}; }
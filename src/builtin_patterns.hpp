@@ -0,0 +1,9 @@
+#pragma once
+#include "pattern.hpp"
+#include <memory>
+#include <vector>
+
+// The built-in patterns, keyed by the bottom-row button (64-71) that starts them.
+// Returns nullptr for notes without a pattern.
+std::unique_ptr<Pattern> makeBuiltinPattern(int note);
+std::vector<int> builtinPatternIds();
@@ -0,0 +1,75 @@
+#include "capture_replayer.hpp"
+#include <chrono>
+#include <thread>
+
+CaptureReplayer::CaptureReplayer(APCMiniController &controller, VirtualApcMini &device) : controller(controller), device(device) {}
+
+bool CaptureReplayer::expectedLedState(const std::vector<EventCapture::Record> &records, std::array<int, 128> &leds) {
+  leds.fill(-1);
+  bool any = false;
+  for (const auto &record : records) {
+    if (record.direction() != EventCapture::Direction::OUTBOUND || record.size() < 3)
+      continue;
+    auto type = record.bytes[0] & 0xF0;
+    if (type == 0x90)
+      leds[record.bytes[1] & 0x7F] = record.bytes[2];
+    else if (type == 0x80)
+      leds[record.bytes[1] & 0x7F] = 0;
+    any = true;
+  }
+  return any;
+}
+
+CaptureReplayer::Result CaptureReplayer::replay(const std::vector<EventCapture::Record> &records, Speed speed) {
+  using Clock = std::chrono::steady_clock;
+  const std::size_t window = APCMiniController::EVENT_QUEUE_CAPACITY / 2;
+  const std::size_t receivedBefore = controller.getStats().eventsReceived;
+  const std::size_t droppedBefore = controller.droppedEventCount();
+
+  Result result;
+  auto start = Clock::now();
+  std::int64_t firstTimeNs = 0;
+  std::size_t dispatched = 0;
+  for (const auto &record : records) {
+    if (record.direction() != EventCapture::Direction::INBOUND)
+      continue;
+    if (speed == Speed::REAL_TIME) {
+      if (result.inbound == 0)
+        firstTimeNs = record.timeNs;
+      std::this_thread::sleep_until(start + std::chrono::nanoseconds(record.timeNs - firstTimeNs));
+    } else {
+      // Keep at most half a queue in flight; polling the counters every 64 events is enough
+      while (result.inbound % 64 == 0 && result.inbound - dispatched >= window) {
+        std::this_thread::yield();
+        dispatched = controller.getStats().eventsReceived - receivedBefore;
+      }
+    }
+    device.inject(record.bytes, record.size(), static_cast<double>(record.rtMidiDelta));
+    result.inbound++;
+    if (result.inbound % 64 == 0)
+      dispatched = controller.getStats().eventsReceived - receivedBefore;
+  }
+
+  // Wait until everything injected was dispatched (or dropped) and the LEDs are written
+  auto deadline = Clock::now() + std::chrono::seconds(10);
+  while (Clock::now() < deadline) {
+    result.dispatched = controller.getStats().eventsReceived - receivedBefore;
+    result.dropped = controller.droppedEventCount() - droppedBefore;
+    if (result.dispatched + result.dropped >= result.inbound)
+      break;
+    std::this_thread::yield();
+  }
+  controller.flushLEDs();
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  result.eventsPerSecond = result.seconds > 0 ? static_cast<double>(result.dispatched) / result.seconds : 0.0;
+
+  std::array<int, 128> expected;
+  if (expectedLedState(records, expected)) {
+    result.ledMismatches = 0;
+    for (int note = 0; note < 128; note++) {
+      if (expected[static_cast<std::size_t>(note)] >= 0 && expected[static_cast<std::size_t>(note)] != device.ledState(note))
+        result.ledMismatches++;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,172 @@
+#include "clip.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char MAGIC[8] = {'A', 'P', 'C', 'C', 'L', 'I', 'P', '1'};
+
+std::uint32_t readU32(const unsigned char *p) {
+  return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 | static_cast<std::uint32_t>(p[2]) << 16 |
+         static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+void appendU16(std::vector<unsigned char> &out, unsigned int value) {
+  out.push_back(static_cast<unsigned char>(value & 0xFF));
+  out.push_back(static_cast<unsigned char>((value >> 8) & 0xFF));
+}
+
+void appendU32(std::vector<unsigned char> &out, std::uint32_t value) {
+  appendU16(out, value & 0xFFFF);
+  appendU16(out, value >> 16);
+}
+
+// Walks every frame once so playback can trust the counts and indices
+bool validate(const unsigned char *data, std::size_t size, std::uint32_t frames) {
+  std::size_t offset = ClipFile::HEADER_SIZE;
+  for (std::uint32_t frame = 0; frame < frames; frame++) {
+    if (size - offset < ClipFile::FRAME_HEADER_SIZE)
+      return false;
+    std::size_t gridChanges = data[offset + 2];
+    std::size_t roundChanges = data[offset + 3];
+    offset += ClipFile::FRAME_HEADER_SIZE;
+    if (size - offset < 2 * (gridChanges + roundChanges))
+      return false;
+    for (std::size_t i = 0; i < gridChanges; i++, offset += 2) {
+      if (data[offset] >= GridFrame::SIZE || data[offset + 1] > static_cast<unsigned char>(APCMiniController::LedColor::YELLOW_BLINK))
+        return false;
+    }
+    for (std::size_t i = 0; i < roundChanges; i++, offset += 2) {
+      if (data[offset] >= GridFrame::ROUND_COUNT || data[offset + 1] > 2)
+        return false;
+    }
+  }
+  return offset == size;
+}
+
+} // namespace
+
+std::shared_ptr<const ClipFile> ClipFile::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Cannot open clip " << path << std::endl;
+    return nullptr;
+  }
+  struct stat info {};
+  void *mapping = MAP_FAILED;
+  std::size_t size = 0;
+  if (fstat(fd, &info) == 0 && info.st_size >= static_cast<off_t>(HEADER_SIZE)) {
+    size = static_cast<std::size_t>(info.st_size);
+    mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd); // The mapping keeps the file alive
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map clip " << path << std::endl;
+    return nullptr;
+  }
+
+  auto data = static_cast<const unsigned char *>(mapping);
+  std::uint32_t frames = readU32(data + 8);
+  if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || frames == 0 || !validate(data, size, frames)) {
+    std::cerr << "Invalid clip " << path << std::endl;
+    munmap(mapping, size);
+    return nullptr;
+  }
+  return std::shared_ptr<const ClipFile>(new ClipFile(data, size, frames));
+}
+
+ClipFile::~ClipFile() { munmap(const_cast<unsigned char *>(data), size); }
+
+ClipPattern::ClipPattern(std::shared_ptr<const ClipFile> clip) : clip(std::move(clip)) { reset(); }
+
+void ClipPattern::render(GridFrame &frame, FrameContext &) {
+  if (cursor == clip->end()) {
+    // Loop: the first frame is relative to a blank grid and leaves unused round LEDs undriven
+    cursor = clip->begin();
+    frame.fill(APCMiniController::LedColor::OFF);
+    frame.clearRound();
+  }
+
+  duration = std::chrono::milliseconds(cursor[0] | cursor[1] << 8);
+  int gridChanges = cursor[2];
+  int roundChanges = cursor[3];
+  cursor += ClipFile::FRAME_HEADER_SIZE;
+  for (int i = 0; i < gridChanges; i++, cursor += 2) {
+    auto color = static_cast<APCMiniController::LedColor>(cursor[1]);
+    int row = cursor[0] / GridFrame::WIDTH;
+    int col = cursor[0] % GridFrame::WIDTH;
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      frame.set(row, tile * GridFrame::WIDTH + col, color);
+    }
+  }
+  for (int i = 0; i < roundChanges; i++, cursor += 2) {
+    for (int tile = 0; tile < frame.tiles(); tile++) {
+      frame.setRound(tile, cursor[0], cursor[1]);
+    }
+  }
+}
+
+void ClipWriter::addFrame(const GridFrame &grid, std::chrono::milliseconds duration, const RoundState &round) {
+  std::vector<unsigned char> gridChanges;
+  for (int index = 0; index < GridFrame::SIZE; index++) {
+    auto color = grid.at(index / GridFrame::WIDTH, index % GridFrame::WIDTH);
+    if (frames == 0 ? color != APCMiniController::LedColor::OFF : color != previous[index]) {
+      gridChanges.push_back(static_cast<unsigned char>(index));
+      gridChanges.push_back(static_cast<unsigned char>(color));
+    }
+    previous[index] = color;
+  }
+  std::vector<unsigned char> roundChanges;
+  for (std::size_t i = 0; i < round.size(); i++) {
+    if (round[i] != previousRound[i]) {
+      roundChanges.push_back(static_cast<unsigned char>(i));
+      roundChanges.push_back(round[i]);
+    }
+    if (round[i] != 0)
+      usedRound = static_cast<std::uint16_t>(usedRound | 1u << i);
+  }
+  previousRound = round;
+  if (frames == 0)
+    firstRound = round;
+
+  appendU16(body, static_cast<unsigned int>(std::min<long long>(duration.count(), 0xFFFF)));
+  body.push_back(static_cast<unsigned char>(gridChanges.size() / 2));
+  body.push_back(static_cast<unsigned char>(roundChanges.size() / 2));
+  body.insert(body.end(), gridChanges.begin(), gridChanges.end());
+  body.insert(body.end(), roundChanges.begin(), roundChanges.end());
+  if (frames == 0)
+    firstFrameSize = body.size();
+  frames++;
+}
+
+bool ClipWriter::save(const std::string &path) const {
+  std::vector<unsigned char> header(MAGIC, MAGIC + sizeof(MAGIC));
+  appendU32(header, static_cast<std::uint32_t>(frames));
+  appendU32(header, 0);
+
+  // Used round LEDs that start off are only known now; the first frame sets them explicitly
+  std::vector<unsigned char> first(body.begin(), body.begin() + static_cast<std::ptrdiff_t>(firstFrameSize));
+  for (std::size_t i = 0; i < firstRound.size(); i++) {
+    if ((usedRound >> i & 1) && firstRound[i] == 0) {
+      first.push_back(static_cast<unsigned char>(i));
+      first.push_back(0);
+      first[3]++;
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+  file.write(reinterpret_cast<const char *>(first.data()), static_cast<std::streamsize>(first.size()));
+  file.write(reinterpret_cast<const char *>(body.data() + firstFrameSize), static_cast<std::streamsize>(body.size() - firstFrameSize));
+  if (!file) {
+    std::cerr << "Cannot write clip " << path << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "pattern.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Precomputed animation clips. A clip file holds 8x8 frames stored as deltas against the
+// previous frame, plus round LED changes and a duration per frame (little endian):
+//
+//   header  "APCCLIP1", uint32 frame count, uint32 reserved (0)
+//   frame   uint16 duration ms, uint8 grid changes, uint8 round changes,
+//           grid changes x (uint8 grid index 0-63, uint8 LedColor),
+//           round changes x (uint8 round index 0-15, uint8 0 off / 1 on / 2 blink)
+//
+// The first frame is relative to an all-off grid with no round LED driven, and sets every round
+// LED the clip uses; looping starts over from there.
+
+// Read-only memory mapping of a validated clip file. Opening reads the whole file once to
+// validate it; the pages are clean file pages the kernel can drop again, and playback only
+// touches the frames it plays.
+class ClipFile {
+public:
+  static constexpr std::size_t HEADER_SIZE = 16;
+  static constexpr std::size_t FRAME_HEADER_SIZE = 4;
+
+  // Returns nullptr (and reports why on std::cerr) if the file is missing or malformed
+  static std::shared_ptr<const ClipFile> open(const std::string &path);
+  ~ClipFile();
+  ClipFile(const ClipFile &) = delete;
+  ClipFile &operator=(const ClipFile &) = delete;
+
+  std::uint32_t frameCount() const { return frames; }
+  const unsigned char *begin() const { return data + HEADER_SIZE; }
+  const unsigned char *end() const { return data + size; }
+
+private:
+  ClipFile(const unsigned char *data, std::size_t size, std::uint32_t frames) : data(data), size(size), frames(frames) {}
+
+  const unsigned char *data;
+  std::size_t size;
+  std::uint32_t frames;
+};
+
+// Streams a clip straight out of its mapping: each frame applies its changes to the layer
+// frame, on every tile of a wide canvas. No decoding state beyond a read pointer.
+class ClipPattern : public Pattern {
+public:
+  explicit ClipPattern(std::shared_ptr<const ClipFile> clip);
+
+  void reset() override { cursor = clip->end(); }
+  void render(GridFrame &frame, FrameContext &context) override;
+  std::chrono::milliseconds period() const override { return duration; }
+
+private:
+  std::shared_ptr<const ClipFile> clip;
+  const unsigned char *cursor;
+  std::chrono::milliseconds duration{0};
+};
+
+// Builds clip files from full frames, e.g. by recording a computed pattern once
+class ClipWriter {
+public:
+  using RoundState = std::array<unsigned char, GridFrame::ROUND_COUNT>; // 0 off, 1 on, 2 blink
+
+  // Only the first 8x8 tile of grid is stored. A round LED counts as used once a frame turns it
+  // on; the clip leaves the others to lower layers.
+  void addFrame(const GridFrame &grid, std::chrono::milliseconds duration, const RoundState &round = {});
+  std::size_t frameCount() const { return frames; }
+  bool save(const std::string &path) const;
+
+private:
+  std::vector<unsigned char> body;
+  std::size_t frames = 0;
+  GridFrame previous;
+  RoundState previousRound{};
+  RoundState firstRound{};
+  std::size_t firstFrameSize = 0;
+  std::uint16_t usedRound = 0; // Bit per round LED
+};
@@ -0,0 +1,173 @@
+#include "cue_executor.hpp"
+#include "apc_mini_layout.hpp"
+#include "light_pattern_controller.hpp"
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+void Cue::promise_type::unhandled_exception() {
+  try {
+    throw;
+  } catch (const std::exception &e) {
+    std::cerr << "Cue failed: " << e.what() << std::endl;
+  } catch (...) {
+    std::cerr << "Cue failed" << std::endl;
+  }
+}
+
+Cue::promise_type::~promise_type() {
+  if (executor)
+    executor->unlink(*this);
+}
+
+CueExecutor::CueExecutor(APCMiniController &ctrl, LightPatternController *patternController) : controller(ctrl), patterns(patternController) {
+  if (patterns) {
+    lastFrame = patterns->frameCount();
+    patterns->setFrameCallback([this](std::uint64_t) {
+      if (wakeOnFrame.load(std::memory_order_relaxed))
+        controller.wake();
+    });
+  }
+  if (!controller.addObserver(this))
+    throw std::runtime_error("No free observer slot for CueExecutor");
+}
+
+CueExecutor::~CueExecutor() {
+  controller.removeObserver(this);
+  if (patterns)
+    patterns->setFrameCallback(nullptr);
+
+  // The waiters live in the frames about to be destroyed
+  pressWaiters.fill(nullptr);
+  faderWaiters.fill(nullptr);
+  frameWaiters = nullptr;
+  while (cues)
+    std::coroutine_handle<Cue::promise_type>::from_promise(*cues).destroy();
+
+  std::lock_guard<std::mutex> lock(spawnMutex);
+  for (auto handle : spawned)
+    handle.destroy();
+}
+
+void CueExecutor::spawn(Cue cue) {
+  auto handle = cue.handle;
+  cue.handle = nullptr;
+  if (!handle)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(spawnMutex);
+    spawned.push_back(handle);
+    hasSpawned.store(true, std::memory_order_release);
+  }
+  controller.wake();
+}
+
+void CueExecutor::start(std::coroutine_handle<Cue::promise_type> handle) {
+  auto &promise = handle.promise();
+  promise.executor = this;
+  promise.next = cues;
+  if (cues)
+    cues->previous = &promise;
+  cues = &promise;
+  running++;
+  handle.resume();
+}
+
+void CueExecutor::unlink(Cue::promise_type &promise) {
+  if (promise.previous)
+    promise.previous->next = promise.next;
+  else
+    cues = promise.next;
+  if (promise.next)
+    promise.next->previous = promise.previous;
+  running--;
+}
+
+CueExecutor::PressAwaiter CueExecutor::nextPress(int note) {
+  if (!ApcMiniLayout::noteInfo(note).valid)
+    throw std::invalid_argument("No button for note " + std::to_string(note));
+  return PressAwaiter(*this, note);
+}
+
+CueExecutor::FaderAwaiter CueExecutor::faderAbove(APCMiniController::Fader fader, int value) {
+  return FaderAwaiter(*this, static_cast<std::size_t>(static_cast<int>(fader) - ApcMiniLayout::FADER_FIRST), value);
+}
+
+CueExecutor::FrameAwaiter CueExecutor::frames(std::uint64_t n) {
+  if (!patterns)
+    throw std::logic_error("CueExecutor::frames() needs a LightPatternController");
+  return FrameAwaiter(*this, n);
+}
+
+void CueExecutor::FrameAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  waiter.handle = handle;
+  waiter.frame = executor.patterns->frameCount() + count;
+  push(executor.frameWaiters, waiter);
+  executor.wakeOnFrame.store(true, std::memory_order_relaxed);
+}
+
+// Waiters are detached before any is resumed: a resumed cue may wait again on the same list,
+// and its node may be gone once it continues. Read next before resuming.
+
+void CueExecutor::onButton(int note, bool isPressed) {
+  if (!isPressed)
+    return;
+  auto *waiter = pressWaiters[static_cast<std::size_t>(note)];
+  pressWaiters[static_cast<std::size_t>(note)] = nullptr;
+  while (waiter) {
+    auto *next = waiter->next;
+    waiter->handle.resume();
+    waiter = next;
+  }
+}
+
+void CueExecutor::onFader(int controlNumber, int value) {
+  auto slot = static_cast<std::size_t>(controlNumber - ApcMiniLayout::FADER_FIRST);
+  if (slot >= faderWaiters.size())
+    return;
+  faderValues[slot] = value;
+  auto *waiter = faderWaiters[slot];
+  faderWaiters[slot] = nullptr;
+  while (waiter) {
+    auto *next = waiter->next;
+    if (value > waiter->threshold) {
+      waiter->value = value;
+      waiter->handle.resume();
+    } else {
+      push(faderWaiters[slot], *waiter);
+    }
+    waiter = next;
+  }
+}
+
+void CueExecutor::onDispatch() {
+  if (hasSpawned.load(std::memory_order_acquire)) {
+    std::vector<std::coroutine_handle<Cue::promise_type>> starting;
+    {
+      std::lock_guard<std::mutex> lock(spawnMutex);
+      starting.swap(spawned);
+      hasSpawned.store(false, std::memory_order_relaxed);
+    }
+    for (auto handle : starting)
+      start(handle);
+  }
+
+  if (!patterns || !frameWaiters)
+    return;
+  auto frame = patterns->frameCount();
+  if (frame == lastFrame)
+    return;
+  lastFrame = frame;
+  auto *waiter = frameWaiters;
+  frameWaiters = nullptr;
+  while (waiter) {
+    auto *next = waiter->next;
+    if (frame >= waiter->frame)
+      waiter->handle.resume();
+    else
+      push(frameWaiters, *waiter);
+    waiter = next;
+  }
+  if (!frameWaiters)
+    wakeOnFrame.store(false, std::memory_order_relaxed);
+}
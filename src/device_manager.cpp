@@ -0,0 +1,131 @@
+#include "device_manager.hpp"
+#include "pattern.hpp"
+#include "rtmidi_transport.hpp"
+#include <chrono>
+#include <iostream>
+
+static_assert(DeviceManager::MAX_DEVICES <= GridFrame::MAX_TILES, "Patterns must be able to span every device");
+
+DeviceManager::~DeviceManager() { stop(); }
+
+std::size_t DeviceManager::addMatchingPorts(const std::string &portName) {
+  std::size_t added = 0;
+  unsigned int count = RtMidiTransport::countPorts(portName);
+  for (unsigned int i = 0; i < count; i++) {
+    if (addDevice(std::make_unique<RtMidiTransport>(portName, i)) < 0)
+      break;
+    added++;
+  }
+  return added;
+}
+
+int DeviceManager::addDevice(std::unique_ptr<MidiTransport> transport) {
+  if (running || devices.size() >= static_cast<std::size_t>(MAX_DEVICES))
+    return -1;
+
+  int id = static_cast<int>(devices.size());
+  auto controller = std::make_unique<APCMiniController>(std::move(transport));
+  controller->setDeviceId(id);
+  controller->setEventSignal(&signal);
+  controller->setButtonCallback([this, id](ButtonType type, int note, bool isPressed) {
+    if (buttonCallback)
+      buttonCallback(id, type, note, isPressed);
+  });
+  controller->setFaderCallback([this, id](Fader fader, int value) {
+    if (faderCallback)
+      faderCallback(id, fader, value);
+  });
+  devices.push_back(std::move(controller));
+  return id;
+}
+
+bool DeviceManager::start() {
+  if (running)
+    return true;
+
+  bool allOpen = !devices.empty();
+  for (auto &controller : devices) {
+    if (realtime)
+      controller->setRealtime(*realtime);
+    // With hot-plug on, a device missing now is left to the PortWatcher to bring up later
+    if (!controller->connect(APCMiniController::DispatchMode::EXTERNAL, hotPlugInterval.count() > 0)) {
+      std::cerr << "Device " << controller->getDeviceId() << (hotPlugInterval.count() > 0 ? " not found, waiting for it" : " failed to connect")
+                << std::endl;
+      allOpen = false;
+    }
+  }
+  running = true;
+  dispatchThread = std::make_unique<std::thread>(&DeviceManager::dispatchLoop, this);
+  if (realtime)
+    applyThreadPolicy(*dispatchThread, realtime->dispatch, "dispatch");
+  if (hotPlugInterval.count() > 0) {
+    portWatcher = std::make_unique<PortWatcher>(controllers(), hotPlugInterval);
+    portWatcher->start();
+  }
+  return allOpen;
+}
+
+void DeviceManager::stop() {
+  if (!running.exchange(false))
+    return;
+  portWatcher.reset();
+  signal.notifyAll();
+  if (dispatchThread && dispatchThread->joinable()) {
+    dispatchThread->join();
+  }
+  dispatchThread.reset();
+  for (auto &controller : devices) {
+    controller->disconnect();
+  }
+}
+
+bool DeviceManager::hasPendingEvents() const {
+  for (const auto &controller : devices) {
+    if (controller->hasPendingEvents())
+      return true;
+  }
+  return false;
+}
+
+void DeviceManager::dispatchLoop() {
+  while (running) {
+    // One batch per device per pass, so a flooding device cannot starve the others
+    std::size_t handled = 0;
+    for (auto &controller : devices) {
+      handled += controller->dispatchPending();
+    }
+    if (handled == 0) {
+      std::chrono::nanoseconds timeout = std::chrono::seconds(1);
+      for (auto &controller : devices) {
+        timeout = controller->dispatchTimeout(timeout);
+      }
+      signal.wait([this]() { return hasPendingEvents() || !running; }, timeout);
+    }
+  }
+}
+
+std::vector<APCMiniController *> DeviceManager::controllers() const {
+  std::vector<APCMiniController *> result;
+  for (const auto &controller : devices) {
+    result.push_back(controller.get());
+  }
+  return result;
+}
+
+void DeviceManager::setCanvasLED(int x, int y, LedColor color) {
+  if (x < 0 || x >= canvasWidth() || y < 0 || y >= canvasHeight())
+    return;
+  devices[static_cast<std::size_t>(x / 8)]->setGridLED(y * 8 + x % 8, color);
+}
+
+void DeviceManager::beginFrame() {
+  for (auto &controller : devices) {
+    controller->beginFrame();
+  }
+}
+
+void DeviceManager::commitFrame() {
+  for (auto &controller : devices) {
+    controller->commitFrame();
+  }
+}
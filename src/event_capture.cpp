@@ -0,0 +1,119 @@
+#include "event_capture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+constexpr char MAGIC[8] = {'A', 'P', 'C', 'C', 'A', 'P', '0', '1'};
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t recordSize;
+  std::uint32_t reserved;
+  std::uint64_t count;
+};
+
+} // namespace
+
+EventCapture::EventCapture(std::size_t capacity) : records(capacity) {}
+
+void EventCapture::append(std::int64_t timeNs, float rtMidiDelta, Direction direction, const unsigned char *data, std::size_t size) {
+  if (!recording.load(std::memory_order_acquire))
+    return;
+  auto slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= records.size()) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto &record = records[slot];
+  record.timeNs = timeNs;
+  record.rtMidiDelta = rtMidiDelta;
+  size = std::min<std::size_t>(size, sizeof(record.bytes));
+  record.flags = static_cast<std::uint8_t>((direction == Direction::OUTBOUND ? 0x80 : 0) | size);
+  std::memset(record.bytes, 0, sizeof(record.bytes));
+  std::memcpy(record.bytes, data, size);
+  written.fetch_add(1, std::memory_order_release);
+}
+
+void EventCapture::recordInbound(std::int64_t timeNs, double rtMidiDelta, const unsigned char *data, std::size_t size) {
+  append(timeNs, static_cast<float>(rtMidiDelta), Direction::INBOUND, data, size);
+}
+
+void EventCapture::recordOutbound(std::int64_t timeNs, const unsigned char *data, std::size_t size) {
+  // Batches arrive in running status; store every message with its status byte
+  unsigned char message[3];
+  unsigned char status = 0;
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    if (data[i] & 0x80) {
+      status = data[i];
+      length = 0;
+      continue;
+    }
+    if (status == 0)
+      continue;
+    if (length == 0)
+      message[length++] = status;
+    message[length++] = data[i];
+    if (length == 3) {
+      append(timeNs, 0.0f, Direction::OUTBOUND, message, length);
+      length = 0;
+    }
+  }
+}
+
+std::size_t EventCapture::size() const { return std::min(nextSlot.load(std::memory_order_relaxed), records.size()); }
+
+std::vector<EventCapture::Record> EventCapture::snapshot() const {
+  // Wait for writers that claimed a slot but have not filled it yet
+  auto count = size();
+  while (written.load(std::memory_order_acquire) < count) {
+    std::this_thread::yield();
+  }
+  return std::vector<Record>(records.begin(), records.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+bool EventCapture::save(const std::string &path) const {
+  auto finished = snapshot();
+  std::ofstream file(path, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot write capture " << path << std::endl;
+    return false;
+  }
+  FileHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.recordSize = sizeof(Record);
+  header.count = finished.size();
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(finished.data()), static_cast<std::streamsize>(finished.size() * sizeof(Record)));
+  return static_cast<bool>(file);
+}
+
+bool EventCapture::load(const std::string &path, std::vector<Record> &out) {
+  std::ifstream file(path, std::ios::binary);
+  FileHeader header{};
+  if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.recordSize != sizeof(Record)) {
+    std::cerr << "Not a capture file: " << path << std::endl;
+    return false;
+  }
+  // The count comes from the file: check it against the file's size before allocating for it
+  file.seekg(0, std::ios::end);
+  auto size = static_cast<std::uint64_t>(file.tellg());
+  file.seekg(sizeof(header));
+  if (!file || header.count > (size - sizeof(header)) / sizeof(Record)) {
+    std::cerr << "Truncated capture file: " << path << std::endl;
+    return false;
+  }
+  out.resize(static_cast<std::size_t>(header.count));
+  if (!file.read(reinterpret_cast<char *>(out.data()), static_cast<std::streamsize>(out.size() * sizeof(Record)))) {
+    std::cerr << "Truncated capture file: " << path << std::endl;
+    out.clear();
+    return false;
+  }
+  return true;
+}
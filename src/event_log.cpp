@@ -0,0 +1,93 @@
+#include "event_log.hpp"
+#include "apc_mini_controller.hpp"
+#include <array>
+#include <chrono>
+#include <ostream>
+
+EventLog::EventLog(std::ostream &output) : output(output) {}
+
+EventLog::~EventLog() { stop(); }
+
+void EventLog::start() {
+  if (!compiledIn(LogLevel::WARN) || formatThread)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = true;
+  }
+  formatThread = std::make_unique<std::thread>(&EventLog::formatLoop, this);
+}
+
+void EventLog::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  cv.notify_one();
+  if (formatThread && formatThread->joinable())
+    formatThread->join();
+  formatThread.reset();
+}
+
+void EventLog::write(LogLevel recordLevel, Kind kind, unsigned char byte0, unsigned char byte1, std::uint32_t value) {
+  if (!enabled(recordLevel))
+    return;
+  Record record{};
+  record.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  record.value = value;
+  record.kind = kind;
+  record.level = recordLevel;
+  record.bytes[0] = byte0;
+  record.bytes[1] = byte1;
+  if (!queue.push(record))
+    dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t EventLog::drain() {
+  std::array<Record, 256> batch;
+  std::size_t total = 0;
+  while (std::size_t count = queue.popBatch(batch.data(), batch.size())) {
+    for (std::size_t i = 0; i < count; i++) {
+      format(batch[i]);
+    }
+    total += count;
+  }
+  if (total > 0)
+    output.flush();
+  return total;
+}
+
+void EventLog::formatLoop() {
+  while (true) {
+    if (drain() > 0)
+      continue;
+    // The producer never signals, so poll at a rate that keeps the log readable live
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!running)
+      break;
+    cv.wait_for(lock, std::chrono::milliseconds(20), [this]() { return !running; });
+  }
+}
+
+void EventLog::format(const Record &record) {
+  switch (record.kind) {
+  case Kind::BUTTON: {
+    auto type = static_cast<APCMiniController::ButtonType>(record.bytes[0]);
+    int note = record.bytes[1];
+    output << "Button: " << APCMiniController::buttonTypeToString(type) << " [" << note << " " << APCMiniController::getButtonName(note)
+           << "] " << (record.value ? "pressed" : "released") << '\n';
+    break;
+  }
+  case Kind::FADER:
+    output << "Fader: (" << static_cast<int>(record.bytes[0]) << ") " << APCMiniController::getFaderName(record.bytes[0]) << " = "
+           << static_cast<int>(record.bytes[1]) << '\n';
+    break;
+  case Kind::DROPPED:
+    output << "Warning: " << record.value << " input events dropped (queue full)" << '\n';
+    break;
+  case Kind::UNHANDLED:
+    output << "Unhandled MIDI message: " << static_cast<int>(record.bytes[0]) << " " << static_cast<int>(record.bytes[1]) << " "
+           << record.value << '\n';
+    break;
+  }
+}
@@ -0,0 +1,49 @@
+#include "fader_stage.hpp"
+#include <cstdlib>
+
+void FaderStage::configure(const Config &newConfig) {
+  config = newConfig;
+  slots = {};
+  pendingCount = 0;
+}
+
+bool FaderStage::accept(Slot &slot, int value, std::int64_t nowNs) const {
+  bool endpoint = value == 0 || value == 127;
+  if (slot.delivered >= 0 && (value == slot.delivered || (!endpoint && std::abs(value - slot.delivered) <= config.hysteresis)))
+    return false;
+  slot.delivered = value;
+  slot.deliveredNs = nowNs;
+  return true;
+}
+
+bool FaderStage::submit(int fader, int value, std::int64_t nowNs) {
+  if (fader < 0 || fader >= FADER_COUNT)
+    return false;
+  auto &slot = slots[static_cast<std::size_t>(fader)];
+  if (config.delivery == Delivery::IMMEDIATE)
+    return config.hysteresis == 0 || accept(slot, value, nowNs);
+
+  slot.latest = value;
+  if (!slot.pending) {
+    slot.pending = true;
+    pendingCount++;
+  }
+  return false;
+}
+
+std::chrono::nanoseconds FaderStage::timeUntilDue(std::int64_t nowNs) const {
+  if (pendingCount == 0)
+    return std::chrono::nanoseconds(-1);
+  if (config.delivery != Delivery::MAX_RATE)
+    return std::chrono::nanoseconds(0);
+
+  std::int64_t earliest = -1;
+  for (const auto &slot : slots) {
+    if (!slot.pending)
+      continue;
+    auto wait = slot.deliveredNs + intervalNs() - nowNs;
+    if (earliest < 0 || wait < earliest)
+      earliest = wait < 0 ? 0 : wait;
+  }
+  return std::chrono::nanoseconds(earliest);
+}
@@ -0,0 +1,73 @@
+#include "frame_scheduler.hpp"
+
+FrameScheduler::FrameScheduler(Clock::duration period) : period(period), nextDeadline(Clock::now()) {}
+
+void FrameScheduler::setPeriod(Clock::duration newPeriod) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (newPeriod > Clock::duration::zero())
+    period = newPeriod;
+}
+
+FrameScheduler::Clock::duration FrameScheduler::getPeriod() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return period;
+}
+
+void FrameScheduler::setLateThreshold(Clock::duration threshold) {
+  std::lock_guard<std::mutex> lock(mutex);
+  lateThreshold = threshold;
+}
+
+bool FrameScheduler::waitForFrame() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopped) {
+    if (woken) {
+      woken = false;
+      nextDeadline = Clock::now();
+    }
+    if (cv.wait_until(lock, nextDeadline, [this]() { return stopped || woken; }))
+      continue;
+
+    auto lateness = Clock::now() - nextDeadline;
+    if (lateness >= period) {
+      auto skipped = lateness / period;
+      stats.missedFrames += static_cast<std::uint64_t>(skipped);
+      nextDeadline += skipped * period;
+      lateness -= skipped * period;
+    }
+    if (lateness > lateThreshold)
+      stats.lateFrames++;
+    if (lateness > stats.maxLateness)
+      stats.maxLateness = lateness;
+    stats.frames++;
+    nextDeadline += period;
+    return true;
+  }
+  return false;
+}
+
+void FrameScheduler::alignNextDeadline(Clock::time_point deadline) {
+  std::lock_guard<std::mutex> lock(mutex);
+  nextDeadline = deadline;
+}
+
+void FrameScheduler::wake() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    woken = true;
+  }
+  cv.notify_one();
+}
+
+void FrameScheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  cv.notify_one();
+}
+
+FrameScheduler::Stats FrameScheduler::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Paces the animation thread on an absolute-deadline clock. Each deadline is the previous
+// one plus the period, so render time never accumulates as drift. The thread sleeps between
+// frames; frames whose slot already passed are skipped and counted as missed.
+class FrameScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    std::uint64_t frames = 0;
+    std::uint64_t lateFrames = 0;   // Started later than the late threshold after their deadline
+    std::uint64_t missedFrames = 0; // Skipped entirely because a whole period had passed
+    Clock::duration maxLateness{0};
+  };
+
+  explicit FrameScheduler(Clock::duration period);
+
+  // Takes effect from the next deadline on
+  void setPeriod(Clock::duration period);
+  Clock::duration getPeriod() const;
+  void setLateThreshold(Clock::duration threshold);
+
+  // Blocks until the next frame is due. Returns false once stop() was called.
+  bool waitForFrame();
+  // Moves the next deadline, e.g. onto an external beat; later ones follow at the period
+  void alignNextDeadline(Clock::time_point deadline);
+  // Cuts the current wait short and restarts the timeline from now
+  void wake();
+  void stop();
+
+  Stats getStats() const;
+
+private:
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  Clock::duration period;
+  Clock::duration lateThreshold{std::chrono::milliseconds(2)};
+  Clock::time_point nextDeadline;
+  bool woken = false;
+  bool stopped = false;
+  Stats stats;
+};
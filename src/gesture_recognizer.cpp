@@ -0,0 +1,27 @@
+#include "gesture_recognizer.hpp"
+#include <algorithm>
+
+void GestureRecognizer::configure(const Config &newConfig) {
+  config = newConfig;
+  notes = {};
+  held = {};
+  chordMembers = {};
+}
+
+std::chrono::nanoseconds GestureRecognizer::timeUntilDue(std::int64_t nowNs) const {
+  std::int64_t earliest = -1;
+  auto consider = [&](std::int64_t dueNs) {
+    if (earliest < 0 || dueNs < earliest)
+      earliest = dueNs;
+  };
+  if (!chordMembers.empty())
+    consider(chordStartNs + toNs(config.chord));
+  held.forEachNote([&](int note) {
+    const auto &state = notes[static_cast<std::size_t>(note)];
+    if (!state.longFired)
+      consider(state.pressNs + toNs(config.longPress));
+  });
+  if (earliest < 0)
+    return std::chrono::nanoseconds(-1);
+  return std::chrono::nanoseconds(std::max<std::int64_t>(0, earliest - nowNs));
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// 3x5 pixel font for text on the grid, built at compile time from the pixel art below. A glyph
+// is stored as columns, bit r of a column byte being row r (top = 0), which is how a scrolling
+// marquee consumes it. Lowercase letters render as uppercase; characters without a glyph
+// render as '?'.
+class GlyphFont {
+public:
+  static constexpr int HEIGHT = 5;
+  static constexpr int MAX_WIDTH = 3;
+
+  struct Glyph {
+    std::array<std::uint8_t, MAX_WIDTH> columns{};
+    int width = 0; // Columns used; narrow glyphs like '.' and ':' take one
+  };
+
+  static constexpr const Glyph &glyph(char c) {
+    if (c >= 'a' && c <= 'z')
+      c = static_cast<char>(c - 'a' + 'A');
+    auto index = static_cast<unsigned char>(c);
+    return (index >= FIRST && index < FIRST + COUNT && TABLE[index - FIRST].width > 0) ? TABLE[index - FIRST] : TABLE['?' - FIRST];
+  }
+
+private:
+  static constexpr int FIRST = ' ';
+  static constexpr int COUNT = '_' - ' ' + 1;
+
+  struct Art {
+    char c;
+    const char *rows; // HEIGHT rows of MAX_WIDTH pixels, '#' lit
+  };
+
+  // clang-format off
+  static constexpr Art ART[] = {
+      {' ', "..." "..." "..." "..." "..."}, {'!', "#.." "#.." "#.." "..." "#.."}, {'\'', "#.." "#.." "..." "..." "..."},
+      {'+', "..." ".#." "###" ".#." "..."}, {',', "..." "..." "..." ".#." "#.."}, {'-', "..." "..." "###" "..." "..."},
+      {'.', "..." "..." "..." "..." "#.."}, {'/', "..#" "..#" ".#." "#.." "#.."}, {':', "..." "#.." "..." "#.." "..."},
+      {'=', "..." "###" "..." "###" "..."}, {'?', "##." "..#" ".#." "..." ".#."}, {'%', "#.#" "..#" ".#." "#.." "#.#"},
+      {'0', "###" "#.#" "#.#" "#.#" "###"}, {'1', ".#." "##." ".#." ".#." "###"}, {'2', "###" "..#" "###" "#.." "###"},
+      {'3', "###" "..#" ".##" "..#" "###"}, {'4', "#.#" "#.#" "###" "..#" "..#"}, {'5', "###" "#.." "###" "..#" "###"},
+      {'6', "###" "#.." "###" "#.#" "###"}, {'7', "###" "..#" "..#" ".#." ".#."}, {'8', "###" "#.#" "###" "#.#" "###"},
+      {'9', "###" "#.#" "###" "..#" "###"}, {'A', ".#." "#.#" "###" "#.#" "#.#"}, {'B', "##." "#.#" "##." "#.#" "##."},
+      {'C', ".##" "#.." "#.." "#.." ".##"}, {'D', "##." "#.#" "#.#" "#.#" "##."}, {'E', "###" "#.." "##." "#.." "###"},
+      {'F', "###" "#.." "##." "#.." "#.."}, {'G', ".##" "#.." "#.#" "#.#" ".##"}, {'H', "#.#" "#.#" "###" "#.#" "#.#"},
+      {'I', "###" ".#." ".#." ".#." "###"}, {'J', "..#" "..#" "..#" "#.#" ".#."}, {'K', "#.#" "#.#" "##." "#.#" "#.#"},
+      {'L', "#.." "#.." "#.." "#.." "###"}, {'M', "#.#" "###" "###" "#.#" "#.#"}, {'N', "##." "#.#" "#.#" "#.#" "#.#"},
+      {'O', ".#." "#.#" "#.#" "#.#" ".#."}, {'P', "##." "#.#" "##." "#.." "#.."}, {'Q', ".#." "#.#" "#.#" "##." ".##"},
+      {'R', "##." "#.#" "##." "#.#" "#.#"}, {'S', ".##" "#.." ".#." "..#" "##."}, {'T', "###" ".#." ".#." ".#." ".#."},
+      {'U', "#.#" "#.#" "#.#" "#.#" "###"}, {'V', "#.#" "#.#" "#.#" "#.#" ".#."}, {'W', "#.#" "#.#" "###" "###" "#.#"},
+      {'X', "#.#" "#.#" ".#." "#.#" "#.#"}, {'Y', "#.#" "#.#" ".#." ".#." ".#."}, {'Z', "###" "..#" ".#." "#.." "###"},
+      {'_', "..." "..." "..." "..." "###"},
+  };
+  // clang-format on
+
+  static constexpr Glyph parse(const char *rows) {
+    Glyph result;
+    for (int row = 0; row < HEIGHT; row++) {
+      for (int col = 0; col < MAX_WIDTH; col++) {
+        if (rows[row * MAX_WIDTH + col] == '#') {
+          result.columns[static_cast<std::size_t>(col)] |= static_cast<std::uint8_t>(1u << row);
+          result.width = col + 1 > result.width ? col + 1 : result.width;
+        }
+      }
+    }
+    if (result.width == 0)
+      result.width = 2; // Space
+    return result;
+  }
+
+  static constexpr std::array<Glyph, COUNT> build() {
+    std::array<Glyph, COUNT> table{};
+    for (const auto &art : ART) {
+      table[static_cast<std::size_t>(art.c - FIRST)] = parse(art.rows);
+    }
+    return table;
+  }
+
+  static const std::array<Glyph, COUNT> TABLE;
+};
+
+inline constexpr std::array<GlyphFont::Glyph, GlyphFont::COUNT> GlyphFont::TABLE = GlyphFont::build();
+
+static_assert(GlyphFont::glyph('1').columns[1] == 0x1F && GlyphFont::glyph('.').width == 1 && GlyphFont::glyph(' ').width == 2);
+static_assert(GlyphFont::glyph('a').columns[0] == GlyphFont::glyph('A').columns[0] && &GlyphFont::glyph('~') == &GlyphFont::glyph('?'));
@@ -0,0 +1,36 @@
+#include "handler_table.hpp"
+#include "apc_mini_layout.hpp"
+
+HandlerTable &HandlerTable::onButton(int note, ButtonHandler handler) {
+  if (!ApcMiniLayout::noteInfo(note).valid)
+    return *this;
+  buttons[static_cast<std::size_t>(note)] = std::move(handler);
+  ownHandlers = ownHandlers | ButtonSet::fromNote(note);
+  return *this;
+}
+
+HandlerTable &HandlerTable::onButtonType(ButtonType type, ButtonHandler handler) {
+  for (int note = 0; note < NOTE_COUNT; note++) {
+    const auto &info = ApcMiniLayout::noteInfo(note);
+    if (info.valid && info.type == type && !ownHandlers.contains(note))
+      buttons[static_cast<std::size_t>(note)] = handler;
+  }
+  return *this;
+}
+
+HandlerTable &HandlerTable::onFader(Fader fader, FaderHandler handler) {
+  auto slot = static_cast<unsigned>(static_cast<int>(fader) - FADER_FIRST);
+  if (slot >= FADER_COUNT)
+    return *this;
+  faders[slot] = std::move(handler);
+  ownFaderMask |= 1u << slot;
+  return *this;
+}
+
+HandlerTable &HandlerTable::onAnyFader(FaderHandler handler) {
+  for (unsigned slot = 0; slot < FADER_COUNT; slot++) {
+    if (!(ownFaderMask & (1u << slot)))
+      faders[slot] = handler;
+  }
+  return *this;
+}
@@ -0,0 +1,35 @@
+#include "latency_histogram.hpp"
+
+std::uint64_t LatencyHistogram::Snapshot::percentileNs(double q) const {
+  if (count == 0)
+    return 0;
+  auto target = static_cast<std::uint64_t>(q * static_cast<double>(count));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+    seen += buckets[i];
+    if (seen > target) {
+      std::uint64_t upper = std::uint64_t{1} << (i + 1);
+      return upper < maxNs ? upper : maxNs;
+    }
+  }
+  return maxNs;
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+  Snapshot result;
+  for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+    result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    result.count += result.buckets[i];
+  }
+  result.sumNs = sum.load(std::memory_order_relaxed);
+  result.maxNs = max.load(std::memory_order_relaxed);
+  return result;
+}
+
+void LatencyHistogram::reset() {
+  for (auto &bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  sum.store(0, std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+}
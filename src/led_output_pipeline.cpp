@@ -0,0 +1,185 @@
+#include "led_output_pipeline.hpp"
+#include <algorithm>
+#include <chrono>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr unsigned char NOTE_ON = 0x90;
+
+std::uint64_t noteBit(int note) { return std::uint64_t{1} << (note % 64); }
+
+std::size_t lowestBit(std::uint64_t bits) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward64(&index, bits);
+  return index;
+#else
+  return static_cast<std::size_t>(__builtin_ctzll(bits));
+#endif
+}
+
+} // namespace
+
+LedOutputPipeline::LedOutputPipeline(Writer writer) : writer(std::move(writer)) { sent.fill(UNKNOWN); }
+
+LedOutputPipeline::~LedOutputPipeline() { stop(); }
+
+void LedOutputPipeline::start(const ThreadPolicy &policy) {
+  if (running.exchange(true))
+    return;
+  writerThread = std::make_unique<std::thread>(&LedOutputPipeline::writerLoop, this);
+  applyThreadPolicy(*writerThread, policy, "LED output");
+}
+
+void LedOutputPipeline::stop() {
+  if (!running.exchange(false))
+    return;
+  signal.notifyAll();
+  if (writerThread && writerThread->joinable()) {
+    writerThread->join();
+  }
+  writerThread.reset();
+  flush();
+}
+
+void LedOutputPipeline::set(int note, unsigned char value) {
+  if (!isLedNote(note))
+    return;
+  auto word = static_cast<std::size_t>(note / 64);
+  auto index = static_cast<std::size_t>(note);
+
+  if (holdDepth.load() > 0) {
+    stagedValues[index].store(value, std::memory_order_relaxed);
+    staged[word].fetch_or(noteBit(note));
+    // The frame may have been released while we staged; then nobody else will publish this note
+    if (holdDepth.load() == 0)
+      publishStaged();
+    return;
+  }
+  values[index].store(value, std::memory_order_relaxed);
+  pending[word].fetch_or(noteBit(note), std::memory_order_release);
+  signal.notify();
+}
+
+void LedOutputPipeline::hold() { holdDepth.fetch_add(1); }
+
+void LedOutputPipeline::release() {
+  int depth = holdDepth.load();
+  while (depth > 0 && !holdDepth.compare_exchange_weak(depth, depth - 1)) {
+  }
+  if (depth == 1)
+    publishStaged();
+}
+
+void LedOutputPipeline::publishStaged() {
+  for (std::size_t word = 0; word < staged.size(); word++) {
+    auto bits = staged[word].exchange(0);
+    for (auto remaining = bits; remaining != 0; remaining &= remaining - 1) {
+      auto index = word * 64 + lowestBit(remaining);
+      values[index].store(stagedValues[index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    if (bits != 0)
+      pending[word].fetch_or(bits, std::memory_order_release);
+  }
+  signal.notify();
+}
+
+void LedOutputPipeline::invalidate() {
+  resendAll.store(true);
+  signal.notify();
+}
+
+bool LedOutputPipeline::hasPending() const {
+  if (resendAll.load(std::memory_order_relaxed))
+    return true;
+  for (const auto &word : pending) {
+    if (word.load(std::memory_order_relaxed) != 0)
+      return true;
+  }
+  return false;
+}
+
+std::size_t LedOutputPipeline::flush() {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  bool ok;
+  return flushLocked(ok);
+}
+
+bool LedOutputPipeline::writeNow(const unsigned char *notes, const unsigned char *newValues, std::size_t count) {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  for (std::size_t i = 0; i < count; i++) {
+    if (!isLedNote(notes[i]))
+      continue;
+    values[notes[i]].store(newValues[i], std::memory_order_relaxed);
+    pending[notes[i] / 64].fetch_or(noteBit(notes[i]), std::memory_order_relaxed);
+  }
+  // Holding writeMutex, nobody else can take these bits: they are written now or not at all
+  bool ok;
+  flushLocked(ok);
+  return ok;
+}
+
+std::size_t LedOutputPipeline::flushLocked(bool &ok) {
+  ok = true;
+  std::array<std::uint64_t, NOTE_COUNT / 64> notes{};
+  for (std::size_t word = 0; word < notes.size(); word++) {
+    notes[word] = pending[word].exchange(0, std::memory_order_acquire);
+  }
+  // Checked after taking the pending bits: an invalidate() racing with this pass is either
+  // handled now or left set for the next one
+  if (resendAll.exchange(false)) {
+    sent.fill(UNKNOWN);
+    for (int note = 0; note < NOTE_COUNT; note++) {
+      if (isLedNote(note))
+        notes[static_cast<std::size_t>(note / 64)] |= noteBit(note);
+    }
+  }
+
+  // One status byte, then a note/value pair per changed LED
+  unsigned char batch[MAX_BATCH_BYTES];
+  unsigned char batchNotes[NOTE_COUNT];
+  std::size_t size = 1;
+  std::size_t count = 0;
+  batch[0] = NOTE_ON;
+  for (std::size_t word = 0; word < notes.size(); word++) {
+    for (auto remaining = notes[word]; remaining != 0; remaining &= remaining - 1) {
+      auto index = word * 64 + lowestBit(remaining);
+      auto value = values[index].load(std::memory_order_relaxed);
+      if (value == sent[index])
+        continue;
+      batch[size++] = static_cast<unsigned char>(index);
+      batch[size++] = value;
+      batchNotes[count++] = static_cast<unsigned char>(index);
+    }
+  }
+  if (count == 0)
+    return 0;
+
+  ok = writer(batch, size, count);
+  for (std::size_t i = 0; i < count; i++) {
+    auto note = batchNotes[i];
+    sent[note] = ok ? batch[1 + 2 * i + 1] : UNKNOWN;
+    // A failed write leaves the notes pending, so the writer thread retries them
+    if (!ok)
+      pending[note / 64].fetch_or(noteBit(note), std::memory_order_relaxed);
+  }
+  failedWrites.store(ok ? 0 : failedWrites.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  return ok ? count : 0;
+}
+
+void LedOutputPipeline::writerLoop() {
+  while (running.load(std::memory_order_acquire)) {
+    if (flush() > 0)
+      continue;
+    if (int failures = failedWrites.load(std::memory_order_relaxed)) {
+      // The device refused the batch: back off, doubling up to MAX_RETRY_INTERVAL
+      auto backoff = std::min(MAX_RETRY_INTERVAL, MIN_RETRY_INTERVAL * (1 << std::min(failures - 1, 8)));
+      signal.wait([this]() { return !running.load(std::memory_order_acquire); }, backoff);
+      continue;
+    }
+    signal.wait([this]() { return hasPending() || !running.load(std::memory_order_acquire); }, std::chrono::seconds(1));
+  }
+}
@@ -0,0 +1,319 @@
+#include "led_scheduler.hpp"
+#include "apc_mini_layout.hpp"
+#include "button_set.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr std::int64_t TICK_NS = 1000000;
+
+std::int64_t toNs(LedScheduler::Clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::int64_t nowNs() { return toNs(LedScheduler::Clock::now()); }
+
+unsigned char roundValue(APCMiniController::RoundLedState state) {
+  return static_cast<unsigned char>(state == APCMiniController::RoundLedState::BLINK ? 2 : (state == APCMiniController::RoundLedState::ON ? 1 : 0));
+}
+
+} // namespace
+
+LedScheduler::LedScheduler(APCMiniController &ctrl, const Config &schedulerConfig) : controller(ctrl), config(schedulerConfig) {
+  config.capacity = std::min<std::size_t>(std::max<std::size_t>(config.capacity, 1), NIL - 1);
+  pool.resize(config.capacity);
+  for (std::uint32_t i = 0; i < pool.size(); i++) {
+    pool[i].next = i + 1 < pool.size() ? i + 1 : NIL;
+  }
+  freeList = 0;
+  heads.fill(NIL);
+  due.reserve(config.capacity);
+  baseTick = nowNs() / TICK_NS;
+}
+
+LedScheduler::~LedScheduler() { stop(); }
+
+void LedScheduler::start() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (running)
+    return;
+  running = true;
+  senderThread = std::make_unique<std::thread>(&LedScheduler::senderLoop, this);
+}
+
+void LedScheduler::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running)
+      return;
+    running = false;
+  }
+  cv.notify_all();
+  if (senderThread && senderThread->joinable()) {
+    senderThread->join();
+  }
+  senderThread.reset();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (std::uint32_t slot = 0; slot <= OVERFLOW_LIST; slot++) {
+    while (heads[slot] != NIL) {
+      auto index = heads[slot];
+      unlink(index);
+      release(index);
+    }
+  }
+}
+
+LedScheduler::Handle LedScheduler::scheduleGridLED(int index, APCMiniController::LedColor color, Clock::time_point when) {
+  if (index < 0 || index >= ApcMiniLayout::GRID_SIZE)
+    return INVALID_HANDLE;
+  return schedule(Target::GRID, index, static_cast<unsigned char>(color), when);
+}
+
+LedScheduler::Handle LedScheduler::scheduleHorizontalLED(APCMiniController::HorizontalButton button, APCMiniController::RoundLedState state,
+                                                         Clock::time_point when) {
+  return schedule(Target::HORIZONTAL, static_cast<int>(button), roundValue(state), when);
+}
+
+LedScheduler::Handle LedScheduler::scheduleVerticalLED(APCMiniController::VerticalButton button, APCMiniController::RoundLedState state,
+                                                       Clock::time_point when) {
+  return schedule(Target::VERTICAL, static_cast<int>(button), roundValue(state), when);
+}
+
+LedScheduler::Handle LedScheduler::schedule(Target target, int address, unsigned char value, Clock::time_point when) {
+  std::int64_t deadline = toNs(when);
+  bool earliest;
+  Handle handle;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (freeList == NIL) {
+      rejected.fetch_add(1, std::memory_order_relaxed);
+      return INVALID_HANDLE;
+    }
+    auto index = freeList;
+    auto &node = pool[index];
+    freeList = node.next;
+    node.deadlineNs = deadline;
+    node.target = target;
+    node.address = static_cast<unsigned char>(address);
+    node.value = value;
+    earliest = deadline < sleepingUntil;
+    link(index);
+    pending++;
+    // Under the lock: once it is released the sender may send the change and reuse the node
+    handle = (static_cast<Handle>(node.generation) << 32) | (index + 1);
+  }
+  scheduled.fetch_add(1, std::memory_order_relaxed);
+  if (earliest)
+    cv.notify_one();
+  return handle;
+}
+
+bool LedScheduler::cancel(Handle handle) {
+  auto index = static_cast<std::uint32_t>(handle & 0xFFFFFFFF) - 1;
+  auto generation = static_cast<std::uint32_t>(handle >> 32);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (handle == INVALID_HANDLE || index >= pool.size() || pool[index].generation != generation || pool[index].list == NIL)
+    return false;
+  unlink(index);
+  release(index);
+  cancelled.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+std::size_t LedScheduler::pendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending;
+}
+
+void LedScheduler::link(std::uint32_t index) {
+  auto &node = pool[index];
+  // An empty wheel may have fallen behind the clock; restart it at now so near deadlines fit
+  if (std::all_of(occupied.begin(), occupied.end(), [](std::uint64_t word) { return word == 0; }))
+    baseTick = std::max(baseTick, nowNs() / TICK_NS);
+  auto tick = std::max(node.deadlineNs / TICK_NS, baseTick);
+  std::uint32_t list = OVERFLOW_LIST;
+  if (tick - baseTick < static_cast<std::int64_t>(WHEEL_SLOTS)) {
+    list = static_cast<std::uint32_t>(tick % static_cast<std::int64_t>(WHEEL_SLOTS));
+    occupied[list / 64] |= std::uint64_t{1} << (list % 64);
+  }
+  node.list = list;
+  node.previous = NIL;
+  node.next = heads[list];
+  if (node.next != NIL)
+    pool[node.next].previous = index;
+  heads[list] = index;
+}
+
+void LedScheduler::unlink(std::uint32_t index) {
+  auto &node = pool[index];
+  if (node.previous != NIL)
+    pool[node.previous].next = node.next;
+  else
+    heads[node.list] = node.next;
+  if (node.next != NIL)
+    pool[node.next].previous = node.previous;
+  if (node.list != OVERFLOW_LIST && heads[node.list] == NIL)
+    occupied[node.list / 64] &= ~(std::uint64_t{1} << (node.list % 64));
+}
+
+void LedScheduler::release(std::uint32_t index) {
+  auto &node = pool[index];
+  node.list = NIL;
+  node.generation++; // Outstanding handles to this node stop matching
+  node.next = freeList;
+  freeList = index;
+  pending--;
+}
+
+std::int64_t LedScheduler::nextDeadlineLocked() const {
+  std::int64_t earliest = std::numeric_limits<std::int64_t>::max();
+  // First occupied slot at or after baseTick, going round the wheel once
+  for (std::size_t step = 0; step < WHEEL_SLOTS;) {
+    auto slot = static_cast<std::size_t>((baseTick + static_cast<std::int64_t>(step)) % static_cast<std::int64_t>(WHEEL_SLOTS));
+    auto bits = occupied[slot / 64] >> (slot % 64);
+    if (bits == 0) {
+      step += 64 - slot % 64;
+      continue;
+    }
+    step += static_cast<std::size_t>(ButtonSet::lowestBit(bits));
+    if (step >= WHEEL_SLOTS)
+      break;
+    slot = static_cast<std::size_t>((baseTick + static_cast<std::int64_t>(step)) % static_cast<std::int64_t>(WHEEL_SLOTS));
+    for (auto index = heads[slot]; index != NIL; index = pool[index].next) {
+      earliest = std::min(earliest, pool[index].deadlineNs);
+    }
+    break;
+  }
+  for (auto index = heads[OVERFLOW_LIST]; index != NIL; index = pool[index].next) {
+    earliest = std::min(earliest, pool[index].deadlineNs);
+  }
+  return earliest;
+}
+
+void LedScheduler::migrateOverflowLocked() {
+  for (auto index = heads[OVERFLOW_LIST]; index != NIL;) {
+    auto next = pool[index].next;
+    if (pool[index].deadlineNs / TICK_NS - baseTick < static_cast<std::int64_t>(WHEEL_SLOTS)) {
+      unlink(index);
+      link(index);
+    }
+    index = next;
+  }
+}
+
+void LedScheduler::collectDueLocked(std::int64_t now) {
+  if (heads[OVERFLOW_LIST] != NIL)
+    migrateOverflowLocked();
+  std::int64_t limit = now + std::chrono::duration_cast<std::chrono::nanoseconds>(config.batchWindow).count();
+  std::int64_t lastTick = std::min(limit / TICK_NS, baseTick + static_cast<std::int64_t>(WHEEL_SLOTS) - 1);
+  for (std::int64_t tick = baseTick; tick <= lastTick; tick++) {
+    auto slot = static_cast<std::uint32_t>(tick % static_cast<std::int64_t>(WHEEL_SLOTS));
+    if (!(occupied[slot / 64] & (std::uint64_t{1} << (slot % 64))))
+      continue;
+    for (auto index = heads[slot]; index != NIL;) {
+      auto next = pool[index].next;
+      const auto &node = pool[index];
+      if (node.deadlineNs <= limit) {
+        due.push_back({node.deadlineNs, node.target, node.address, node.value});
+        unlink(index);
+        release(index);
+      }
+      index = next;
+    }
+  }
+  // Every slot before now's tick has been emptied
+  baseTick = std::max(baseTick, now / TICK_NS);
+  if (heads[OVERFLOW_LIST] != NIL)
+    migrateOverflowLocked();
+}
+
+// Round LED addresses are their notes already
+unsigned char LedScheduler::noteOf(const Due &change) {
+  return change.target == Target::GRID ? static_cast<unsigned char>(ApcMiniLayout::gridNote(change.address)) : change.address;
+}
+
+void LedScheduler::senderLoop() {
+  auto spinNs = std::chrono::duration_cast<std::chrono::nanoseconds>(config.spin).count();
+  std::unique_lock<std::mutex> lock(mutex);
+  while (running) {
+    auto deadline = nextDeadlineLocked();
+    sleepingUntil = deadline;
+    if (deadline == std::numeric_limits<std::int64_t>::max()) {
+      cv.wait(lock);
+      continue;
+    }
+    if (nowNs() < deadline - spinNs) {
+      // Woken early by an earlier deadline or stop(): start over
+      cv.wait_until(lock, Clock::time_point(std::chrono::nanoseconds(deadline - spinNs)));
+      continue;
+    }
+    // Nobody needs to wake a spinning sender
+    sleepingUntil = std::numeric_limits<std::int64_t>::min();
+    lock.unlock();
+    while (nowNs() < deadline) {
+      std::this_thread::yield();
+    }
+    lock.lock();
+
+    due.clear();
+    collectDueLocked(nowNs());
+    if (due.empty())
+      continue; // Cancelled while spinning
+    lock.unlock();
+
+    // Past any frame another thread holds open, so the timing below is that of the actual write
+    bool ok = true;
+    for (std::size_t begin = 0; begin < due.size(); begin += LedOutputPipeline::NOTE_COUNT) {
+      unsigned char notes[LedOutputPipeline::NOTE_COUNT];
+      unsigned char values[LedOutputPipeline::NOTE_COUNT];
+      auto count = std::min<std::size_t>(due.size() - begin, LedOutputPipeline::NOTE_COUNT);
+      for (std::size_t i = 0; i < count; i++) {
+        notes[i] = noteOf(due[begin + i]);
+        values[i] = due[begin + i].value;
+      }
+      ok = controller.writeLEDsNow(notes, values, count) && ok;
+    }
+    auto written = nowNs();
+    if (!ok) {
+      failed.fetch_add(due.size(), std::memory_order_relaxed);
+      lock.lock();
+      continue;
+    }
+    for (const auto &change : due) {
+      auto late = written - change.deadlineNs;
+      if (late >= 0)
+        lateness.record(static_cast<std::uint64_t>(late));
+      else
+        earliness.record(static_cast<std::uint64_t>(-late));
+    }
+    sent.fetch_add(due.size(), std::memory_order_relaxed);
+    batches.fetch_add(1, std::memory_order_relaxed);
+    lock.lock();
+  }
+}
+
+LedScheduler::Stats LedScheduler::getStats() const {
+  Stats stats;
+  stats.scheduled = scheduled.load(std::memory_order_relaxed);
+  stats.sent = sent.load(std::memory_order_relaxed);
+  stats.cancelled = cancelled.load(std::memory_order_relaxed);
+  stats.rejected = rejected.load(std::memory_order_relaxed);
+  stats.failed = failed.load(std::memory_order_relaxed);
+  stats.batches = batches.load(std::memory_order_relaxed);
+  stats.lateness = lateness.snapshot();
+  stats.earliness = earliness.snapshot();
+  return stats;
+}
+
+void LedScheduler::resetStats() {
+  scheduled.store(0, std::memory_order_relaxed);
+  sent.store(0, std::memory_order_relaxed);
+  cancelled.store(0, std::memory_order_relaxed);
+  rejected.store(0, std::memory_order_relaxed);
+  failed.store(0, std::memory_order_relaxed);
+  batches.store(0, std::memory_order_relaxed);
+  lateness.reset();
+  earliness.reset();
+}
@@ -1,193 +1,327 @@
 #include "light_pattern_controller.hpp"
+#include "builtin_patterns.hpp"
+#include "clip.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <functional>
+#include <iostream>
 #include <random>
+#include <stdexcept>
 #include <thread>
 #include <unordered_map>
 
-const std::vector<std::pair<int, int>> LightPatternController::SPIRAL_PATH = {
-    {3, 3}, {3, 4}, {4, 4}, {4, 3}, {3, 2}, {2, 2}, {2, 3}, {2, 4}, {2, 5}, {3, 5}, {4, 5}, {5, 5}, {5, 4}, {5, 3}, {5, 2}, {5, 1},
-    {4, 1}, {3, 1}, {2, 1}, {1, 1}, {1, 2}, {1, 3}, {1, 4}, {1, 5}, {1, 6}, {2, 6}, {3, 6}, {4, 6}, {5, 6}, {6, 6}, {6, 5}, {6, 4},
-    {6, 3}, {6, 2}, {6, 1}, {6, 0}, {5, 0}, {4, 0}, {3, 0}, {2, 0}, {1, 0}, {0, 0}, {0, 1}, {0, 2}, {0, 3}, {0, 4}, {0, 5}, {0, 6},
-    {0, 7}, {1, 7}, {2, 7}, {3, 7}, {4, 7}, {5, 7}, {6, 7}, {7, 7}, {7, 6}, {7, 5}, {7, 4}, {7, 3}, {7, 2}, {7, 1}, {7, 0}};
+LightPatternController::LightPatternController(APCMiniController &ctrl, bool startThread)
+    : LightPatternController(std::vector<APCMiniController *>{&ctrl}, startThread) {}
 
-LightPatternController::LightPatternController(APCMiniController &ctrl) : controller(ctrl) {
+LightPatternController::LightPatternController(std::vector<APCMiniController *> devices, bool startThread)
+    : outputs(std::move(devices)), scheduler(DEFAULT_FRAME_INTERVAL) {
+  if (outputs.empty() || outputs.size() > static_cast<std::size_t>(GridFrame::MAX_TILES))
+    throw std::invalid_argument("LightPatternController needs 1 to 4 output devices");
+  composite = GridFrame(static_cast<int>(outputs.size()));
+  lastOutput = composite;
+
+  for (int id : patternIds()) {
+    patternCounters.try_emplace(id);
+  }
+  patternCounters.try_emplace(CUSTOM_PATTERN);
+  layers.push_back(Layer{BACKGROUND_LAYER, 0, BlendMode::REPLACE, CUSTOM_PATTERN, nullptr, composite, 0, {}});
+
+  if (!startThread)
+    return;
   isRunning = true;
   animationThread = std::make_unique<std::thread>(&LightPatternController::animationLoop, this);
 }
 
 LightPatternController::~LightPatternController() {
   isRunning = false;
+  scheduler.stop();
   if (animationThread && animationThread->joinable()) {
     animationThread->join();
   }
 }
 
-void LightPatternController::clearGrid() {
-  for (int i = 0; i < 64; i++) {
-    controller.setGridLED(i, APCMiniController::LedColor::OFF);
+void LightPatternController::startPattern(int buttonIndex) {
+  auto pattern = makePattern(buttonIndex);
+  {
+    std::lock_guard<std::mutex> lock(layerMutex);
+    for (auto &layer : layers) {
+      if (layer.id == BACKGROUND_LAYER) {
+        layer.statsKey = buttonIndex;
+        restartLayerLocked(layer, std::move(pattern));
+      }
+    }
   }
+  scheduler.wake();
+}
+
+void LightPatternController::registerClip(int id, std::string path) {
+  std::lock_guard<std::mutex> lock(layerMutex);
+  clipPaths[id] = std::move(path);
 }
 
-void LightPatternController::startPattern(int buttonIndex) { currentPattern = buttonIndex; }
+std::unique_ptr<Pattern> LightPatternController::makePattern(int id) {
+  std::string clipPath;
+  {
+    std::lock_guard<std::mutex> lock(layerMutex);
+    auto it = clipPaths.find(id);
+    if (it != clipPaths.end())
+      clipPath = it->second;
+  }
+  if (clipPath.empty())
+    return makeBuiltinPattern(id);
+  // Mapped and validated outside the lock so a large clip does not stall the animation
+  auto clip = ClipFile::open(clipPath);
+  return clip ? std::make_unique<ClipPattern>(std::move(clip)) : nullptr;
+}
 
 void LightPatternController::stopCurrentPattern() {
-  clearGrid();
-  currentPattern = -1;
+  {
+    std::lock_guard<std::mutex> lock(layerMutex);
+    for (auto &layer : layers) {
+      if (layer.id == BACKGROUND_LAYER)
+        restartLayerLocked(layer, nullptr);
+    }
+    composeAndOutputLocked();
+  }
+  scheduler.wake();
+}
+
+int LightPatternController::addLayer(std::unique_ptr<Pattern> pattern, int priority, BlendMode blend) {
+  int id;
+  {
+    std::lock_guard<std::mutex> lock(layerMutex);
+    id = nextLayerId++;
+    auto position = std::upper_bound(layers.begin(), layers.end(), priority, [](int p, const Layer &layer) { return p < layer.priority; });
+    auto inserted = layers.insert(position, Layer{id, priority, blend, CUSTOM_PATTERN, nullptr, composite, 0, {}});
+    restartLayerLocked(*inserted, std::move(pattern));
+  }
+  scheduler.wake();
+  return id;
+}
+
+bool LightPatternController::removeLayer(int layerId) {
+  if (layerId == BACKGROUND_LAYER)
+    return false;
+  {
+    std::lock_guard<std::mutex> lock(layerMutex);
+    auto it = std::find_if(layers.begin(), layers.end(), [layerId](const Layer &layer) { return layer.id == layerId; });
+    if (it == layers.end())
+      return false;
+    layers.erase(it);
+    composeAndOutputLocked();
+  }
+  scheduler.wake();
+  return true;
+}
+
+void LightPatternController::restartLayerLocked(Layer &layer, std::unique_ptr<Pattern> pattern) {
+  layer.pattern = std::move(pattern);
+  layer.frame.fill(APCMiniController::LedColor::OFF);
+  layer.frame.clearRound();
+  layer.frameNumber = 0;
+  layer.nextDue = std::chrono::steady_clock::now();
+  if (layer.pattern)
+    layer.pattern->reset();
+}
+
+bool LightPatternController::setThreadPolicy(const ThreadPolicy &policy) {
+  return animationThread && applyThreadPolicy(*animationThread, policy, "animation");
+}
+
+void LightPatternController::syncToClock(const MidiClock *clock, int beatFrames) {
+  framesPerBeat = std::max(1, beatFrames);
+  beatClock = clock;
+  scheduler.wake();
+}
+
+// Points the scheduler at the next beat subdivision, or at a layer with its own rate that is
+// due before it. FRAME if there is no usable clock.
+LightPatternController::Tick LightPatternController::alignToBeat(Tick previous) {
+  const auto *clock = beatClock.load();
+  if (!clock)
+    return Tick::FRAME;
+  auto now = std::chrono::steady_clock::now();
+  auto position = clock->position(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+  if (!position.running || !position.locked)
+    return Tick::FRAME;
+
+  int subdivisions = framesPerBeat.load();
+  auto subdivisionNs = position.beatPeriodNs / subdivisions;
+  double step = position.beats * subdivisions;
+  // A subdivision ticked a hair early counts as rendered and must not render again right after
+  // it, also when a layer tick comes in between
+  if (previous == Tick::BEAT && step >= static_cast<double>(beatStep) - 0.5)
+    renderedBeatStep = beatStep;
+  auto next = static_cast<std::int64_t>(std::floor(step)) + 1;
+  if (next == renderedBeatStep)
+    next++;
+  auto deadline = now + std::chrono::nanoseconds(static_cast<std::int64_t>((static_cast<double>(next) - step) * static_cast<double>(subdivisionNs)));
+  auto tick = Tick::BEAT;
+  {
+    std::lock_guard<std::mutex> lock(layerMutex);
+    for (const auto &layer : layers) {
+      if (layer.pattern && layer.pattern->period().count() > 0 && layer.nextDue < deadline) {
+        deadline = layer.nextDue;
+        tick = Tick::LAYER;
+      }
+    }
+  }
+  if (tick == Tick::BEAT)
+    beatStep = next;
+  scheduler.setPeriod(std::chrono::nanoseconds(subdivisionNs));
+  scheduler.alignNextDeadline(deadline);
+  return tick;
+}
+
+void LightPatternController::setFrameRate(double framesPerSecond) {
+  if (framesPerSecond <= 0)
+    return;
+  frameInterval = std::max(std::chrono::nanoseconds(1),
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / framesPerSecond)));
+  scheduler.wake();
+}
+
+FrameScheduler::Stats LightPatternController::frameStats() const { return scheduler.getStats(); }
+
+std::chrono::nanoseconds LightPatternController::periodFor(const Layer &layer) const {
+  auto period = layer.pattern ? layer.pattern->period() : std::chrono::milliseconds(0);
+  return period.count() > 0 ? std::chrono::nanoseconds(period) : frameInterval.load();
+}
+
+std::chrono::nanoseconds LightPatternController::tickPeriod() {
+  std::lock_guard<std::mutex> lock(layerMutex);
+  std::chrono::nanoseconds shortest{0};
+  for (const auto &layer : layers) {
+    if (!layer.pattern)
+      continue;
+    auto period = periodFor(layer);
+    if (shortest.count() == 0 || period < shortest)
+      shortest = period;
+  }
+  return shortest.count() > 0 ? shortest : frameInterval.load();
 }
 
 void LightPatternController::animationLoop() {
   std::cout << "LightPatternController Thread ID: " << std::this_thread::get_id() << std::endl;
 
-  using namespace std::chrono;
-  auto nextFrame = steady_clock::now();
-
+  auto tick = Tick::FRAME;
   while (isRunning) {
-    auto now = steady_clock::now();
-    if (now >= nextFrame) {
-      if (auto pattern = currentPattern.load()) {
-        if (auto it = patterns.find(pattern); it != patterns.end()) {
-          it->second(controller, currentPattern, rng);
-        }
-      }
-      nextFrame = now + milliseconds(100);
+    // Tick at the fastest layer's rate (or on the beat and whenever a layer with its own rate is
+    // due); slower layers only render when they are due
+    tick = alignToBeat(tick);
+    if (tick == Tick::FRAME)
+      scheduler.setPeriod(tickPeriod());
+    if (!scheduler.waitForFrame())
+      break;
+    std::lock_guard<std::mutex> lock(layerMutex);
+    renderLayersLocked(false, tick);
+  }
+}
+
+void LightPatternController::renderFrame() {
+  std::lock_guard<std::mutex> lock(layerMutex);
+  renderLayersLocked(true);
+}
+
+void LightPatternController::renderLayersLocked(bool renderAll, Tick tick) {
+  auto now = std::chrono::steady_clock::now();
+  for (auto &layer : layers) {
+    if (!layer.pattern)
+      continue;
+    // On the beat, layers without their own rate render on subdivisions only
+    bool followsBeat = tick != Tick::FRAME && layer.pattern->period().count() == 0;
+    if (renderAll || (followsBeat ? tick == Tick::BEAT : now >= layer.nextDue))
+      renderLayerLocked(layer, now);
+  }
+  composeAndOutputLocked();
+  auto frame = framesOutput.fetch_add(1, std::memory_order_release) + 1;
+  if (frameCallback)
+    frameCallback(frame);
+}
+
+void LightPatternController::setFrameCallback(FrameCallback callback) {
+  std::lock_guard<std::mutex> lock(layerMutex);
+  frameCallback = std::move(callback);
+}
+
+void LightPatternController::renderLayerLocked(Layer &layer, std::chrono::steady_clock::time_point now) {
+  auto start = std::chrono::steady_clock::now();
+  FrameContext context{layer.frameNumber, rng};
+  layer.pattern->render(layer.frame, context);
+  layer.frameNumber++;
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  auto period = periodFor(layer);
+  layer.nextDue = (layer.nextDue + period <= now) ? now + period : layer.nextDue + period;
+
+  auto &counters = patternCounters.at(patternCounters.count(layer.statsKey) ? layer.statsKey : CUSTOM_PATTERN);
+  counters.frames.fetch_add(1, std::memory_order_relaxed);
+  counters.renderTime.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  if (elapsed > period)
+    counters.overruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void LightPatternController::composeAndOutputLocked() {
+  composite.fill(APCMiniController::LedColor::OFF);
+  composite.clearRound();
+  for (const auto &layer : layers) {
+    if (layer.pattern)
+      blendInto(composite, layer.frame, layer.blend);
+  }
+
+  // Only the cells that changed since the last frame go out on the wire
+  for (std::size_t tile = 0; tile < outputs.size(); tile++) {
+    auto &controller = *outputs[tile];
+    int firstCol = static_cast<int>(tile) * GridFrame::WIDTH;
+    controller.beginFrame();
+    for (int i = 0; i < GridFrame::SIZE; i++) {
+      int row = i / GridFrame::WIDTH;
+      int col = firstCol + i % GridFrame::WIDTH;
+      if (!outputValid || composite.at(row, col) != lastOutput.at(row, col))
+        controller.setGridLED(i, composite.at(row, col));
+    }
+    // Round LEDs are left to the application unless a layer drives them; when the last layer
+    // that did goes away they are switched off
+    for (int i = 0; i < GridFrame::ROUND_COUNT; i++) {
+      auto slot = tile * GridFrame::ROUND_COUNT + static_cast<std::size_t>(i);
+      auto state = composite.round[slot];
+      auto previous = outputValid ? lastOutput.round[slot] : GridFrame::ROUND_UNSET;
+      if (state == previous)
+        continue;
+      setRoundLED(controller, i, state == GridFrame::ROUND_UNSET ? 0 : state);
     }
-    std::this_thread::yield();
+    controller.commitFrame();
   }
+  lastOutput = composite;
+  outputValid = true;
+}
+
+void LightPatternController::setRoundLED(APCMiniController &controller, int index, unsigned char state) {
+  auto ledState = state == 2 ? APCMiniController::RoundLedState::BLINK
+                             : (state == 1 ? APCMiniController::RoundLedState::ON : APCMiniController::RoundLedState::OFF);
+  if (index < 8)
+    controller.setHorizontalLED(static_cast<APCMiniController::HorizontalButton>(64 + index), ledState);
+  else
+    controller.setVerticalLED(static_cast<APCMiniController::VerticalButton>(82 + index - 8), ledState);
 }
 
-const std::unordered_map<int, LightPatternController::PatternFunc> 
-LightPatternController::patterns = {
-   // Snake Pattern
-   {64, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937&) {
-       static int pos = 0;
-       for(int i = 0; i < 64; i++) {
-           ctrl.setGridLED(i, i == pos ? 
-               APCMiniController::LedColor::GREEN_BLINK : 
-               APCMiniController::LedColor::OFF);
-       }
-       pos = (pos + 1) % 64;
-   }},
-
-   // Rainfall Pattern  
-   {65, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937& rng) {
-       static std::vector<int> drops(8, -1);
-       static std::uniform_int_distribution<> dist(0, 7);
-
-       for(int col = 0; col < 8; col++) {
-           if(drops[col] == -1 && dist(rng) == 0) {
-               drops[col] = 0;
-           }
-           if(drops[col] >= 0) {
-               ctrl.setGridLED(drops[col] * 8 + col,
-                   APCMiniController::LedColor::YELLOW_BLINK);
-               drops[col]++;
-               if(drops[col] >= 8) drops[col] = -1;
-           }
-       }
-   }},
-
-   // Color Wave
-   {66, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937&) {
-       static int wave = 0;
-       for(int row = 0; row < 8; row++) {
-           for(int col = 0; col < 8; col++) {
-               int phase = (row + col + wave) % 3;
-               APCMiniController::LedColor color;
-               switch(phase) {
-                   case 0: color = APCMiniController::LedColor::GREEN; break;
-                   case 1: color = APCMiniController::LedColor::RED; break;
-                   case 2: color = APCMiniController::LedColor::YELLOW; break;
-                   default: color = APCMiniController::LedColor::OFF;
-               }
-               ctrl.setGridLED(row * 8 + col, color);
-           }
-       }
-       wave = (wave + 1) % 16;
-   }},
-
-   // Expanding Square
-   {67, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937&) {
-       static int size = 0;
-       for(int i = -size; i <= size; i++) {
-           for(int j = -size; j <= size; j++) {
-               if(abs(i) == size || abs(j) == size) {
-                   int row = 3 + i;
-                   int col = 3 + j;
-                   if(row >= 0 && row < 8 && col >= 0 && col < 8) {
-                       ctrl.setGridLED(row * 8 + col, 
-                           APCMiniController::LedColor::RED_BLINK);
-                   }
-               }
-           }
-       }
-       size = (size + 1) % 4;
-   }},
-
-   // Sparkle Pattern
-   {68, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937& rng) {
-       static std::uniform_int_distribution<> pos_dist(0, 63);
-       static std::uniform_int_distribution<> color_dist(0, 2);
-
-       for(int i = 0; i < 5; i++) {
-           int pos = pos_dist(rng);
-           APCMiniController::LedColor color;
-           switch(color_dist(rng)) {
-               case 0: color = APCMiniController::LedColor::GREEN_BLINK; break;
-               case 1: color = APCMiniController::LedColor::RED_BLINK; break;
-               default: color = APCMiniController::LedColor::YELLOW_BLINK;
-           }
-           ctrl.setGridLED(pos, color);
-       }
-
-       for(int i = 0; i < 3; i++) {
-           ctrl.setGridLED(pos_dist(rng), APCMiniController::LedColor::OFF);
-       }
-   }},
-
-   // Checkerboard Pattern
-   {69, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937&) {
-       static bool alternate = false;
-       for(int row = 0; row < 8; row++) {
-           for(int col = 0; col < 8; col++) {
-               bool isEven = (row + col) % 2 == 0;
-               ctrl.setGridLED(
-                   row * 8 + col,
-                   (isEven != alternate) ? 
-                       APCMiniController::LedColor::GREEN : 
-                       APCMiniController::LedColor::RED
-               );
-           }
-       }
-       alternate = !alternate;
-   }},
-
-   // Spiral Pattern
-   {70, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937&) {
-       static size_t currentPos = 0;
-       if(currentPos < SPIRAL_PATH.size()) {
-           const auto& pos = SPIRAL_PATH[currentPos];
-           ctrl.setGridLED(
-               pos.first * 8 + pos.second,
-               APCMiniController::LedColor::YELLOW_BLINK
-           );
-           currentPos = (currentPos + 1) % SPIRAL_PATH.size();
-       }
-   }},
-
-   // Binary Counter
-   {71, [](APCMiniController& ctrl, std::atomic<int>& pattern, std::mt19937&) {
-       static int count = 0;
-       for(int bit = 0; bit < 8; bit++) {
-           if(count & (1 << bit)) {
-               for(int row = 0; row < 8; row++) {
-                   ctrl.setGridLED(row * 8 + bit,
-                       APCMiniController::LedColor::GREEN);
-               }
-           }
-       }
-       count = (count + 1) % 256;
-   }}
-};
+std::vector<int> LightPatternController::patternIds() { return builtinPatternIds(); }
+
+LightPatternController::Stats LightPatternController::getStats() const {
+  Stats stats;
+  stats.scheduler = scheduler.getStats();
+  std::vector<int> ids = patternIds();
+  ids.insert(ids.begin(), CUSTOM_PATTERN);
+  for (int id : ids) {
+    const auto &counters = patternCounters.at(id);
+    PatternStats pattern;
+    pattern.pattern = id;
+    pattern.frames = counters.frames.load(std::memory_order_relaxed);
+    pattern.overruns = counters.overruns.load(std::memory_order_relaxed);
+    pattern.renderTime = counters.renderTime.snapshot();
+    stats.patterns.push_back(pattern);
+  }
+  return stats;
+}
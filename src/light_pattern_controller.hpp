@@ -1,29 +1,138 @@
 #pragma once
 #include "apc_mini_controller.hpp"
+#include "frame_scheduler.hpp"
+#include "latency_histogram.hpp"
+#include "midi_clock.hpp"
+#include "pattern.hpp"
+#include "thread_policy.hpp"
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
+// Runs patterns as a stack of layers. Each layer renders into its own in-memory frame at its
+// own rate; every tick the layers are blended bottom to top by priority into one output frame
+// and only the cells that changed are written to the controller. Given several controllers,
+// the frame is a canvas spanning all of them, left to right in the order given.
 class LightPatternController {
+public:
+  static constexpr std::chrono::milliseconds DEFAULT_FRAME_INTERVAL{100};
+  static constexpr int BACKGROUND_LAYER = 0; // Layer driven by startPattern()
+  static constexpr int CUSTOM_PATTERN = -1;  // Stats key for layers added with addLayer()
+
 private:
-  APCMiniController &controller;
-  std::atomic<int> currentPattern{-1};
+  struct Layer {
+    int id;
+    int priority;
+    BlendMode blend;
+    int statsKey;
+    std::unique_ptr<Pattern> pattern;
+    GridFrame frame;
+    std::uint64_t frameNumber = 0;
+    std::chrono::steady_clock::time_point nextDue;
+  };
+
+  // What the next animation tick is for: the frame rate, a beat subdivision, or a layer with
+  // its own rate that is due before the next subdivision
+  enum class Tick { FRAME, BEAT, LAYER };
+
+  struct PatternCounters {
+    std::atomic<std::uint64_t> frames{0};
+    std::atomic<std::uint64_t> overruns{0};
+    LatencyHistogram renderTime;
+  };
+
+  std::vector<APCMiniController *> outputs; // One 8x8 tile each
   std::unique_ptr<std::thread> animationThread;
   std::mt19937 rng{std::random_device{}()};
   std::atomic<bool> isRunning{false};
+  FrameScheduler scheduler;
+  std::atomic<std::chrono::nanoseconds> frameInterval{DEFAULT_FRAME_INTERVAL}; // Unrounded, so 60 fps is not 62.5
+  std::atomic<const MidiClock *> beatClock{nullptr};
+  std::atomic<int> framesPerBeat{4};
+  std::int64_t beatStep = -1;         // Subdivision the last BEAT tick was aimed at; animation thread only
+  std::int64_t renderedBeatStep = -1; // Last subdivision rendered
+
+  std::mutex layerMutex;
+  std::vector<Layer> layers; // Sorted by priority, lowest first
+  int nextLayerId = BACKGROUND_LAYER + 1;
+  GridFrame composite;
+  GridFrame lastOutput;
+  bool outputValid = false;
+
+  // One entry per built-in pattern plus CUSTOM_PATTERN, created up front so lookups never mutate the map
+  std::unordered_map<int, PatternCounters> patternCounters;
+  std::unordered_map<int, std::string> clipPaths; // Guarded by layerMutex
+  std::atomic<std::uint64_t> framesOutput{0};
+  std::function<void(std::uint64_t frame)> frameCallback; // Guarded by layerMutex
 
-  void clearGrid();
   void animationLoop();
-  static const std::vector<std::pair<int, int>> SPIRAL_PATH;
-  using PatternFunc = std::function<void(APCMiniController &, std::atomic<int> &, std::mt19937 &)>;
-  static const std::unordered_map<int, PatternFunc> patterns;
+  std::chrono::nanoseconds periodFor(const Layer &layer) const;
+  std::chrono::nanoseconds tickPeriod();
+  void renderLayersLocked(bool renderAll, Tick tick = Tick::FRAME);
+  Tick alignToBeat(Tick previous);
+  void renderLayerLocked(Layer &layer, std::chrono::steady_clock::time_point now);
+  void composeAndOutputLocked();
+  void restartLayerLocked(Layer &layer, std::unique_ptr<Pattern> pattern);
+  std::unique_ptr<Pattern> makePattern(int id);
+  static void setRoundLED(APCMiniController &controller, int index, unsigned char state);
 
 public:
-  explicit LightPatternController(APCMiniController &ctrl);
+  // With startThread = false no animation thread runs and the caller drives renderFrame()
+  explicit LightPatternController(APCMiniController &ctrl, bool startThread = true);
+  // Renders across up to GridFrame::MAX_TILES devices, e.g. DeviceManager::controllers()
+  explicit LightPatternController(std::vector<APCMiniController *> outputs, bool startThread = true);
   ~LightPatternController();
+
+  // Replaces the background layer with a registered clip or a built-in pattern
   void startPattern(int buttonIndex);
+  // Makes startPattern(id) play a clip file (see clip.hpp), taking precedence over a built-in
+  // pattern with the same id. Only the path is stored; the file is mapped when the clip starts.
+  void registerClip(int id, std::string path);
   void stopCurrentPattern();
+  // Renders every layer once and outputs the composed frame on the calling thread
+  void renderFrame();
+  static std::vector<int> patternIds();
+  int canvasWidth() const { return composite.width; }
+
+  // Frames composed and output so far, by the animation thread or renderFrame()
+  std::uint64_t frameCount() const { return framesOutput.load(std::memory_order_acquire); }
+  // Called after every output frame on the thread that rendered it, with layerMutex held: it
+  // must not call back into this LightPatternController
+  using FrameCallback = std::function<void(std::uint64_t frame)>;
+  void setFrameCallback(FrameCallback callback);
+
+  // Overlays: higher priority layers are drawn on top. Returns a layer id.
+  int addLayer(std::unique_ptr<Pattern> pattern, int priority, BlendMode blend = BlendMode::OVER);
+  bool removeLayer(int layerId);
+
+  // Frame rate for patterns that do not declare their own
+  void setFrameRate(double framesPerSecond);
+  // While the clock is running and locked, patterns that do not declare their own rate render
+  // on beat subdivisions instead of at the frame rate, e.g. controller.getMidiClock().
+  // nullptr returns to the frame rate.
+  void syncToClock(const MidiClock *clock, int framesPerBeat = 4);
+  FrameScheduler::Stats frameStats() const;
+  // Pins and prioritizes the animation thread, see APCMiniController::RealtimeConfig. Rendering
+  // does not allocate while the layers stay the same; startPattern() and addLayer() do.
+  bool setThreadPolicy(const ThreadPolicy &policy);
+
+  struct PatternStats {
+    int pattern = 0; // Built-in pattern id or CUSTOM_PATTERN
+    std::uint64_t frames = 0;
+    std::uint64_t overruns = 0; // Frames whose render took longer than the frame period
+    LatencyHistogram::Snapshot renderTime;
+  };
+  struct Stats {
+    FrameScheduler::Stats scheduler;
+    std::vector<PatternStats> patterns; // Sorted by pattern id
+  };
+  Stats getStats() const;
 };
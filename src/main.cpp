@@ -1,5 +1,12 @@
 #include "apc_mini_controller.hpp"
+#include "apc_mini_layout.hpp"
+#include "event_capture.hpp"
+#include "handler_table.hpp"
 #include "light_pattern_controller.hpp"
+#include "port_watcher.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
 #include <signal.h>
 
 volatile sig_atomic_t keep_running = 1;
@@ -10,40 +17,44 @@ int main() {
     signal(SIGINT, signalHandler);
     APCMiniController controller;
 
+    // APC_MINI_CAPTURE=<file> records the session (16 MB buffer) for CaptureReplayer
+    const char *capturePath = std::getenv("APC_MINI_CAPTURE");
+    std::unique_ptr<EventCapture> capture;
+    if (capturePath) {
+      capture = std::make_unique<EventCapture>(1 << 20);
+      controller.setCapture(capture.get());
+    }
+
     if (!controller.connect()) {
       std::cerr << "Failed to connect to APC Mini" << std::endl;
       return 1;
     }
 
     LightPatternController patternController(controller);
-
-    std::unordered_map<int, bool> buttonStates;
+    // Survive the USB cable being pulled: reconnect and restore the LEDs when it comes back
+    PortWatcher portWatcher(controller);
+    portWatcher.start();
 
     // std::cout << "main() Thread ID: " << std::this_thread::get_id() << std::endl;
 
-    controller.setButtonCallback(
-        [&controller, &patternController, &buttonStates](APCMiniController::ButtonType type, int note, bool isPressed) {
-          // std::cout << "setButtonCallback Thread ID: " << std::this_thread::get_id() << std::endl;
+    using RoundLedState = APCMiniController::RoundLedState;
+    auto handlers = std::make_unique<HandlerTable>();
+    handlers->onButtonType(APCMiniController::ButtonType::HORIZONTAL, [&controller, &patternController](int note, bool isPressed) {
+      controller.setHorizontalLED(static_cast<APCMiniController::HorizontalButton>(note), isPressed ? RoundLedState::ON : RoundLedState::OFF);
+      if (isPressed)
+        patternController.startPattern(note);
+    });
+    handlers->onButtonType(APCMiniController::ButtonType::VERTICAL, [&controller](int note, bool isPressed) {
+      controller.setVerticalLED(static_cast<APCMiniController::VerticalButton>(note), isPressed ? RoundLedState::ON : RoundLedState::OFF);
+    });
+    controller.setHandlers(std::move(handlers));
 
-          if (type == APCMiniController::ButtonType::HORIZONTAL) {
-            if (isPressed) {
-              controller.setHorizontalLED(static_cast<APCMiniController::HorizontalButton>(note), APCMiniController::RoundLedState::ON);
-              buttonStates[note] = true;
-              patternController.startPattern(note);
-            } else {
-              controller.setHorizontalLED(static_cast<APCMiniController::HorizontalButton>(note), APCMiniController::RoundLedState::OFF);
-              buttonStates[note] = false;
-            }
-          } else if (type == APCMiniController::ButtonType::VERTICAL) {
-            if (isPressed) {
-              controller.setVerticalLED(static_cast<APCMiniController::VerticalButton>(note), APCMiniController::RoundLedState::ON);
-              buttonStates[note] = true;
-            } else {
-              controller.setVerticalLED(static_cast<APCMiniController::VerticalButton>(note), APCMiniController::RoundLedState::OFF);
-              buttonStates[note] = false;
-            }
-          }
-        });
+    // Holding a pattern button stops the pattern it started
+    controller.setGestureCallback([&patternController](const APCMiniController::Gesture &gesture) {
+      if (gesture.type == APCMiniController::Gesture::Type::LONG_PRESS &&
+          ApcMiniLayout::noteInfo(gesture.note).type == APCMiniController::ButtonType::HORIZONTAL)
+        patternController.stopCurrentPattern();
+    });
 
     // Print available patterns
     std::cout << "\nAPC Mini Light Controller Ready!\n"
@@ -56,6 +67,7 @@ int main() {
               << "69: Checkerboard\n"
               << "70: Spiral Pattern\n"
               << "71: Binary Counter\n"
+              << "Hold a pattern button to stop it.\n"
               << "\nPress Ctrl+C to exit...\n"
               << std::endl;
 
@@ -65,7 +77,13 @@ int main() {
 
     std::cout << "\nShutting down..." << std::endl;
     patternController.stopCurrentPattern();
+    portWatcher.stop();
     controller.disconnect();
+    if (capture) {
+      capture->stop();
+      if (capture->save(capturePath))
+        std::cout << "Capture saved to " << capturePath << " (" << capture->size() << " records)" << std::endl;
+    }
 
     return 0;
   } catch (const std::exception &e) {
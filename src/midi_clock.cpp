@@ -0,0 +1,96 @@
+#include "midi_clock.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr std::uint32_t RUNNING = 1;
+constexpr std::uint32_t LOCKED = 2;
+} // namespace
+
+void MidiClock::feed(unsigned char status, std::int64_t timeNs) {
+  switch (status) {
+  case START:
+    songPulses = -1;
+    running = true;
+    break;
+  case CONTINUE:
+    running = true;
+    break;
+  case STOP:
+    running = false;
+    break;
+  case CLOCK: {
+    pulsesReceived.fetch_add(1, std::memory_order_relaxed);
+    if (running)
+      songPulses++;
+    if (lastPulseNs == 0) {
+      lastPulseNs = timeNs;
+      break;
+    }
+    if (periodNs <= 0) {
+      periodNs = static_cast<double>(timeNs - lastPulseNs);
+      lastPulseNs = timeNs;
+      break;
+    }
+    double predicted = static_cast<double>(lastPulseNs) + periodNs;
+    double error = static_cast<double>(timeNs) - predicted;
+    if (std::fabs(error) > periodNs) {
+      // Tempo change or a gap in the stream: start over from the raw interval
+      periodNs = std::max(1.0, static_cast<double>(timeNs - lastPulseNs));
+      lastPulseNs = timeNs;
+      consistentPulses = 0;
+    } else {
+      lastPulseNs = static_cast<std::int64_t>(predicted + ALPHA * error);
+      periodNs += BETA * error;
+      consistentPulses = std::min(consistentPulses + 1, LOCK_PULSES);
+    }
+    break;
+  }
+  default:
+    return;
+  }
+  publish();
+}
+
+void MidiClock::publish() {
+  auto next = sequence.load(std::memory_order_relaxed) + 1;
+  sequence.store(next, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  publishedPulseNs.store(lastPulseNs, std::memory_order_relaxed);
+  publishedPeriodNs.store(static_cast<std::int64_t>(periodNs), std::memory_order_relaxed);
+  publishedSongPulses.store(songPulses, std::memory_order_relaxed);
+  publishedFlags.store((running ? RUNNING : 0) | (consistentPulses >= LOCK_PULSES ? LOCKED : 0), std::memory_order_relaxed);
+  sequence.store(next + 1, std::memory_order_release);
+}
+
+MidiClock::Position MidiClock::position(std::int64_t timeNs) const {
+  std::int64_t pulseNs, period, pulses;
+  std::uint32_t flags;
+  for (;;) {
+    auto before = sequence.load(std::memory_order_acquire);
+    pulseNs = publishedPulseNs.load(std::memory_order_relaxed);
+    period = publishedPeriodNs.load(std::memory_order_relaxed);
+    pulses = publishedSongPulses.load(std::memory_order_relaxed);
+    flags = publishedFlags.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((before & 1) == 0 && sequence.load(std::memory_order_relaxed) == before)
+      break;
+  }
+
+  Position position;
+  position.running = (flags & RUNNING) != 0;
+  position.locked = (flags & LOCKED) != 0;
+  if (period <= 0)
+    return position;
+  // A source that stopped sending pulses without a Stop no longer drives anything
+  if (timeNs - pulseNs > STALE_PULSES * period)
+    position.locked = false;
+  position.beatPeriodNs = period * PULSES_PER_QUARTER;
+  position.bpm = 60e9 / static_cast<double>(position.beatPeriodNs);
+  if (pulses >= 0) {
+    // Extrapolate at most one pulse, so a clock that stops arriving freezes the position
+    double sincePulse = std::min(1.0, std::max(0.0, static_cast<double>(timeNs - pulseNs) / static_cast<double>(period)));
+    position.beats = (static_cast<double>(pulses) + (position.running ? sincePulse : 0.0)) / PULSES_PER_QUARTER;
+  }
+  return position;
+}
@@ -0,0 +1,26 @@
+#include "midi_transport.hpp"
+
+bool MidiTransport::sendBatch(const unsigned char *data, std::size_t size) {
+  unsigned char message[3];
+  unsigned char status = 0;
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    unsigned char byte = data[i];
+    if (byte & 0x80) {
+      status = byte;
+      length = 0;
+      continue;
+    }
+    if (status == 0)
+      continue;
+    if (length == 0)
+      message[length++] = status;
+    message[length++] = byte;
+    if (length == 3) {
+      if (!send(message, sizeof(message)))
+        return false;
+      length = 0;
+    }
+  }
+  return true;
+}
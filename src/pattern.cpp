@@ -0,0 +1,37 @@
+#include "pattern.hpp"
+#include "bitboard.hpp"
+
+namespace {
+
+using LedColor = APCMiniController::LedColor;
+
+// LedColor split into green/red channels plus blink, so MIX can add channels
+constexpr unsigned char channels(LedColor color) { return ColorPlanes::channels(color); }
+constexpr LedColor fromChannels(unsigned char bits) { return ColorPlanes::fromChannels(bits); }
+
+static_assert(fromChannels(channels(LedColor::GREEN_BLINK) | channels(LedColor::RED)) == LedColor::YELLOW_BLINK);
+
+} // namespace
+
+void blendInto(GridFrame &destination, const GridFrame &source, BlendMode mode) {
+  for (std::size_t i = 0; i < source.round.size(); i++) {
+    if (source.round[i] != GridFrame::ROUND_UNSET)
+      destination.round[i] = source.round[i];
+  }
+  switch (mode) {
+  case BlendMode::REPLACE:
+    destination.cells = source.cells;
+    break;
+  case BlendMode::OVER:
+    for (int i = 0; i < destination.size(); i++) {
+      if (source[i] != LedColor::OFF)
+        destination[i] = source[i];
+    }
+    break;
+  case BlendMode::MIX:
+    for (int i = 0; i < destination.size(); i++) {
+      destination[i] = fromChannels(channels(destination[i]) | channels(source[i]));
+    }
+    break;
+  }
+}
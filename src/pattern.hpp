@@ -0,0 +1,70 @@
+#pragma once
+#include "apc_mini_controller.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Grid image, row-major with row 0 at the top. A single device is 8x8 (setGridLED index order);
+// side-by-side devices form a wider canvas of up to MAX_TILES grids, tile 0 on the left.
+// Each tile also has its 16 round LEDs (8 horizontal, then 8 vertical), which stay
+// ROUND_UNSET unless a pattern drives them.
+struct GridFrame {
+  using LedColor = APCMiniController::LedColor;
+  static constexpr int WIDTH = 8; // One device
+  static constexpr int HEIGHT = 8;
+  static constexpr int SIZE = WIDTH * HEIGHT;
+  static constexpr int MAX_TILES = 4;
+  static constexpr int MAX_WIDTH = WIDTH * MAX_TILES;
+  static constexpr int ROUND_COUNT = 16;
+  static constexpr unsigned char ROUND_UNSET = 0xFF; // Otherwise 0 = off, 1 = on, 2 = blink
+
+  int width = WIDTH;
+  std::array<LedColor, MAX_WIDTH * HEIGHT> cells{}; // All OFF
+  std::array<unsigned char, MAX_TILES * ROUND_COUNT> round;
+
+  GridFrame() { clearRound(); }
+  explicit GridFrame(int tiles) : width(WIDTH * tiles) { clearRound(); }
+
+  int size() const { return width * HEIGHT; }
+  int tiles() const { return width / WIDTH; }
+  LedColor &operator[](int index) { return cells[static_cast<std::size_t>(index)]; }
+  LedColor operator[](int index) const { return cells[static_cast<std::size_t>(index)]; }
+  LedColor at(int row, int col) const { return cells[static_cast<std::size_t>(row * width + col)]; }
+  void set(int row, int col, LedColor color) { cells[static_cast<std::size_t>(row * width + col)] = color; }
+  void fill(LedColor color) { cells.fill(color); }
+  void clearRound() { round.fill(ROUND_UNSET); }
+  // Round LED of a tile: 0-7 horizontal buttons (notes 64-71), 8-15 scene buttons (notes 82-89)
+  void setRound(int tile, int index, unsigned char state) { round[static_cast<std::size_t>(tile * ROUND_COUNT + index)] = state; }
+  bool operator==(const GridFrame &other) const { return width == other.width && cells == other.cells && round == other.round; }
+  bool operator!=(const GridFrame &other) const { return !(*this == other); }
+};
+
+// How a layer is composited onto the layers below it
+enum class BlendMode {
+  REPLACE, // The layer covers everything below, including its OFF cells
+  OVER,    // Lit cells cover what is below, OFF cells are transparent
+  MIX      // Color channels add up (green + red = yellow), blinking if either blinks
+};
+
+// Both frames must have the same width. Round LEDs a layer leaves unset are transparent.
+void blendInto(GridFrame &destination, const GridFrame &source, BlendMode mode);
+
+struct FrameContext {
+  std::uint64_t frameNumber; // Frames this layer has rendered since it was (re)started
+  std::mt19937 &rng;
+};
+
+// A pattern owns all of its animation state and renders into its layer's frame, which
+// persists between frames so a pattern only has to touch the cells it changes. The frame
+// spans every output device, so patterns should size themselves from frame.width.
+class Pattern {
+public:
+  virtual ~Pattern() = default;
+
+  // Called when the pattern is (re)started; the layer frame has been cleared
+  virtual void reset() {}
+  virtual void render(GridFrame &frame, FrameContext &context) = 0;
+  // Time until the next frame; 0 uses the controller frame rate. Read after every render.
+  virtual std::chrono::milliseconds period() const { return std::chrono::milliseconds(0); }
+};
@@ -0,0 +1,46 @@
+#include "port_watcher.hpp"
+
+PortWatcher::PortWatcher(std::vector<APCMiniController *> controllers, std::chrono::milliseconds interval)
+    : controllers(std::move(controllers)), interval(interval) {}
+
+PortWatcher::PortWatcher(APCMiniController &controller, std::chrono::milliseconds interval)
+    : PortWatcher(std::vector<APCMiniController *>{&controller}, interval) {}
+
+PortWatcher::~PortWatcher() { stop(); }
+
+void PortWatcher::start() {
+  if (watchThread)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = false;
+  }
+  watchThread = std::make_unique<std::thread>(&PortWatcher::watchLoop, this);
+}
+
+void PortWatcher::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (watchThread && watchThread->joinable()) {
+    watchThread->join();
+  }
+  watchThread.reset();
+}
+
+void PortWatcher::checkNow() {
+  for (auto *controller : controllers) {
+    controller->checkConnection();
+  }
+}
+
+void PortWatcher::watchLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!cv.wait_for(lock, interval, [this]() { return stopping; })) {
+    lock.unlock();
+    checkNow();
+    lock.lock();
+  }
+}
@@ -0,0 +1,131 @@
+#include "rtmidi_transport.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Port number of the n-th port whose name contains portName, -1 if there are fewer matches
+int findPort(RtMidi &midi, const std::string &portName, unsigned int matchIndex) {
+  for (unsigned int i = 0; i < midi.getPortCount(); i++) {
+    if (midi.getPortName(i).find(portName) != std::string::npos && matchIndex-- == 0)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+int findExactPort(RtMidi &midi, const std::string &name) {
+  if (name.empty())
+    return -1;
+  for (unsigned int i = 0; i < midi.getPortCount(); i++) {
+    if (midi.getPortName(i) == name)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+unsigned int countMatches(RtMidi &midi, const std::string &portName) {
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < midi.getPortCount(); i++) {
+    if (midi.getPortName(i).find(portName) != std::string::npos)
+      count++;
+  }
+  return count;
+}
+
+} // namespace
+
+RtMidiTransport::RtMidiTransport(std::string portName, unsigned int matchIndex) : portName(std::move(portName)), matchIndex(matchIndex) {
+  try {
+    midiIn = std::make_unique<RtMidiIn>();
+    midiOut = std::make_unique<RtMidiOut>();
+  } catch (RtMidiError &error) {
+    std::cerr << "RtMidi error: " << error.getMessage() << std::endl;
+    throw;
+  }
+}
+
+RtMidiTransport::~RtMidiTransport() { close(); }
+
+void RtMidiTransport::setInputHandler(InputHandler handler, void *userData) {
+  inputHandler = handler;
+  inputUserData = userData;
+}
+
+void RtMidiTransport::rtMidiCallback(double timeStamp, std::vector<unsigned char> *message, void *userData) {
+  auto transport = static_cast<RtMidiTransport *>(userData);
+  if (transport->inputHandler)
+    transport->inputHandler(timeStamp, message->data(), message->size(), transport->inputUserData);
+}
+
+bool RtMidiTransport::open() {
+  int inputPort = findExactPort(*midiIn, inputName);
+  int outputPort = findExactPort(*midiOut, outputName);
+  if (inputPort == -1 || outputPort == -1) {
+    inputPort = findPort(*midiIn, portName, matchIndex);
+    outputPort = findPort(*midiOut, portName, matchIndex);
+  }
+
+  if (inputPort == -1 || outputPort == -1) {
+    std::cerr << "APC Mini ports not found" << std::endl;
+    return false;
+  }
+
+  try {
+    inputName = midiIn->getPortName(static_cast<unsigned int>(inputPort));
+    outputName = midiOut->getPortName(static_cast<unsigned int>(outputPort));
+    midiIn->openPort(static_cast<unsigned int>(inputPort));
+    midiOut->openPort(static_cast<unsigned int>(outputPort));
+  } catch (RtMidiError &error) {
+    std::cerr << "Error opening ports: " << error.getMessage() << std::endl;
+    // Leave nothing half open for the next attempt
+    if (midiIn->isPortOpen())
+      midiIn->closePort();
+    return false;
+  }
+
+  midiIn->setCallback(&rtMidiCallback, this);
+  // SysEx and timing (MIDI clock) are delivered; active sensing only costs a callback every 300 ms
+  midiIn->ignoreTypes(false, false, true);
+  return true;
+}
+
+void RtMidiTransport::close() {
+  if (midiIn && midiIn->isPortOpen()) {
+    // RtMidi refuses a second setCallback() on reopen unless the first one is cancelled
+    midiIn->cancelCallback();
+    midiIn->closePort();
+  }
+  if (midiOut)
+    midiOut->closePort();
+}
+
+bool RtMidiTransport::isAvailable() {
+  // An open port must still be listed; a closed one only needs a port to open again
+  if (isOpen())
+    return findExactPort(*midiIn, inputName) != -1;
+  return (findExactPort(*midiIn, inputName) != -1 && findExactPort(*midiOut, outputName) != -1) ||
+         (findPort(*midiIn, portName, matchIndex) != -1 && findPort(*midiOut, portName, matchIndex) != -1);
+}
+
+bool RtMidiTransport::send(const unsigned char *data, std::size_t size) {
+  if (!midiOut || !midiOut->isPortOpen())
+    return false;
+  try {
+    midiOut->sendMessage(data, size);
+    return true;
+  } catch (RtMidiError &error) {
+    std::cerr << "Error sending MIDI message: " << error.getMessage() << std::endl;
+    return false;
+  }
+}
+
+unsigned int RtMidiTransport::countPorts(const std::string &portName) {
+  try {
+    RtMidiIn midiIn;
+    RtMidiOut midiOut;
+    return std::min(countMatches(midiIn, portName), countMatches(midiOut, portName));
+  } catch (RtMidiError &error) {
+    std::cerr << "RtMidi error: " << error.getMessage() << std::endl;
+    return 0;
+  }
+}
@@ -0,0 +1,298 @@
+#include "shared_event_bus.hpp"
+#include "apc_mini_layout.hpp"
+#include "led_output_pipeline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Segment layout. Slot n of the ring holds event number n modulo the capacity; its sequence is
+// 2n + 1 while being written and 2n + 2 once complete, so a reader can tell a torn or
+// overwritten slot from the one it expects.
+struct SharedBusSlot {
+  std::atomic<std::uint64_t> sequence;
+  std::atomic<std::int64_t> timeNs;
+  std::atomic<std::uint64_t> payload; // kind | buttonType << 8 | device << 16 | number << 24 | value << 32
+};
+
+struct SharedBusLayout {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t capacity;
+  std::int32_t publisherPid; // Process that created the segment, to tell a stale one from a live one
+  alignas(64) std::atomic<std::uint64_t> published; // Events written
+  alignas(64) std::array<std::atomic<unsigned char>, LedOutputPipeline::NOTE_COUNT> ledValues;
+  std::array<std::atomic<std::uint64_t>, LedOutputPipeline::NOTE_COUNT / 64> ledDirty;
+
+  SharedBusSlot *slots() { return reinterpret_cast<SharedBusSlot *>(reinterpret_cast<unsigned char *>(this) + SLOTS_OFFSET); }
+  static std::size_t sizeFor(std::size_t capacity) { return SLOTS_OFFSET + capacity * sizeof(SharedBusSlot); }
+
+  static constexpr std::size_t SLOTS_OFFSET = 320;
+};
+
+namespace {
+
+constexpr char MAGIC[8] = {'A', 'P', 'C', 'B', 'U', 'S', '0', '1'};
+constexpr std::uint32_t VERSION = 2;
+
+static_assert(sizeof(SharedBusLayout) <= SharedBusLayout::SLOTS_OFFSET, "Ring slots must follow the header");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<unsigned char>::is_always_lock_free,
+              "Shared memory needs address-free atomics");
+
+std::uint64_t pack(const APCMiniController::ControllerEvent &event) {
+  return static_cast<std::uint64_t>(event.kind) | static_cast<std::uint64_t>(event.buttonType) << 8 |
+         static_cast<std::uint64_t>(event.device) << 16 | static_cast<std::uint64_t>(event.number) << 24 |
+         static_cast<std::uint64_t>(event.value) << 32;
+}
+
+APCMiniController::ControllerEvent unpack(std::uint64_t payload, std::int64_t timeNs) {
+  return {static_cast<APCMiniController::ControllerEvent::Kind>(payload & 0xFF), static_cast<APCMiniController::ButtonType>((payload >> 8) & 0xFF),
+          static_cast<unsigned char>(payload >> 16), static_cast<unsigned char>(payload >> 24), static_cast<unsigned char>(payload >> 32), timeNs};
+}
+
+std::size_t roundUpPowerOfTwo(std::size_t value) {
+  std::size_t result = 1;
+  while (result < value)
+    result <<= 1;
+  return result;
+}
+
+// True for an event bus segment whose publisher has exited without removing it. Segments of
+// other programs, and buses whose publisher is alive, are never touched.
+bool isStaleBus(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+  struct stat info {};
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(SharedBusLayout))
+    mapping = mmap(nullptr, sizeof(SharedBusLayout), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+  const auto *layout = static_cast<const SharedBusLayout *>(mapping);
+  bool stale = std::memcmp(layout->magic, MAGIC, sizeof(MAGIC)) == 0 && layout->version == VERSION && layout->publisherPid > 0 &&
+               kill(layout->publisherPid, 0) != 0 && errno == ESRCH;
+  munmap(mapping, sizeof(SharedBusLayout));
+  return stale;
+}
+
+std::int64_t steadyNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+std::unique_ptr<SharedEventBus> SharedEventBus::create(APCMiniController &controller, const std::string &name, std::size_t capacity,
+                                                       std::chrono::milliseconds ledInterval) {
+  capacity = roundUpPowerOfTwo(std::max<std::size_t>(capacity, 2));
+  auto size = SharedBusLayout::sizeFor(capacity);
+
+  // Never reuse a live segment: resetting it would corrupt the ring under its publisher and readers
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0 && errno == EEXIST && isStaleBus(name)) {
+    std::cerr << "Removing stale shared memory " << name << " left by an exited publisher" << std::endl;
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  }
+  if (fd < 0) {
+    std::cerr << "Cannot create shared memory " << name << ": " << std::strerror(errno) << std::endl;
+    return nullptr;
+  }
+  void *mapping = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map shared memory " << name << ": " << std::strerror(errno) << std::endl;
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  auto *layout = new (mapping) SharedBusLayout{};
+  layout->version = VERSION;
+  layout->capacity = static_cast<std::uint32_t>(capacity);
+  layout->publisherPid = static_cast<std::int32_t>(getpid());
+  for (std::size_t i = 0; i < capacity; i++) {
+    new (&layout->slots()[i]) SharedBusSlot{};
+  }
+  // Clients check the magic last, once everything else is in place
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(layout->magic, MAGIC, sizeof(MAGIC));
+
+  std::unique_ptr<SharedEventBus> bus(new SharedEventBus(controller, name, layout, size, capacity, ledInterval));
+  if (!controller.addObserver(bus.get())) {
+    std::cerr << "No free observer slot for SharedEventBus" << std::endl;
+    return nullptr;
+  }
+  bus->mergeThread = std::make_unique<std::thread>(&SharedEventBus::mergeLoop, bus.get());
+  return bus;
+}
+
+SharedEventBus::SharedEventBus(APCMiniController &ctrl, std::string busName, SharedBusLayout *mapped, std::size_t size,
+                               std::size_t capacity, std::chrono::milliseconds interval)
+    : controller(ctrl), name(std::move(busName)), layout(mapped), mappedSize(size), ringSize(capacity), ledInterval(interval) {}
+
+SharedEventBus::~SharedEventBus() {
+  controller.removeObserver(this);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cv.notify_all();
+  if (mergeThread && mergeThread->joinable()) {
+    mergeThread->join();
+  }
+  // Clients keep their mapping until they close it
+  munmap(layout, mappedSize);
+  shm_unlink(name.c_str());
+}
+
+std::uint64_t SharedEventBus::publishedCount() const { return layout->published.load(std::memory_order_relaxed); }
+
+void SharedEventBus::publish(APCMiniController::ControllerEvent::Kind kind, int number, int value) {
+  const auto &info = ApcMiniLayout::noteInfo(number);
+  APCMiniController::ControllerEvent event{kind,
+                                           kind == APCMiniController::ControllerEvent::Kind::BUTTON ? info.type : APCMiniController::ButtonType::SPECIAL,
+                                           static_cast<unsigned char>(controller.getDeviceId()),
+                                           static_cast<unsigned char>(number),
+                                           static_cast<unsigned char>(value),
+                                           steadyNowNs()};
+  auto n = layout->published.load(std::memory_order_relaxed);
+  auto &slot = layout->slots()[n & (ringSize - 1)];
+  slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.timeNs.store(event.timeNs, std::memory_order_relaxed);
+  slot.payload.store(pack(event), std::memory_order_relaxed);
+  slot.sequence.store(2 * n + 2, std::memory_order_release);
+  layout->published.store(n + 1, std::memory_order_release);
+}
+
+void SharedEventBus::onButton(int note, bool isPressed) { publish(APCMiniController::ControllerEvent::Kind::BUTTON, note, isPressed); }
+
+void SharedEventBus::onFader(int controlNumber, int value) { publish(APCMiniController::ControllerEvent::Kind::FADER, controlNumber, value); }
+
+std::size_t SharedEventBus::mergeLEDs() {
+  std::size_t applied = 0;
+  for (std::size_t word = 0; word < layout->ledDirty.size(); word++) {
+    auto bits = layout->ledDirty[word].exchange(0, std::memory_order_acquire);
+    for (; bits != 0; bits &= bits - 1) {
+      int note = static_cast<int>(word * 64) + ButtonSet::lowestBit(bits);
+      auto value = layout->ledValues[static_cast<std::size_t>(note)].load(std::memory_order_relaxed);
+      const auto &info = ApcMiniLayout::noteInfo(note);
+      // Any local process can write the segment; a value of 0x80 or more would go out as a status byte
+      bool isGrid = info.type == APCMiniController::ButtonType::GRID;
+      if (!LedOutputPipeline::isLedNote(note) || value > (isGrid ? static_cast<unsigned char>(APCMiniController::LedColor::YELLOW_BLINK) : 2))
+        continue;
+      auto state = value == 2 ? APCMiniController::RoundLedState::BLINK : (value ? APCMiniController::RoundLedState::ON : APCMiniController::RoundLedState::OFF);
+      if (isGrid)
+        controller.setGridLED(info.index, static_cast<APCMiniController::LedColor>(value));
+      else if (info.type == APCMiniController::ButtonType::HORIZONTAL)
+        controller.setHorizontalLED(static_cast<APCMiniController::HorizontalButton>(note), state);
+      else
+        controller.setVerticalLED(static_cast<APCMiniController::VerticalButton>(note), state);
+      applied++;
+    }
+  }
+  return applied;
+}
+
+void SharedEventBus::mergeLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    cv.wait_for(lock, ledInterval, [this]() { return stopping; });
+    if (stopping)
+      break;
+    if ((layout->ledDirty[0].load(std::memory_order_relaxed) | layout->ledDirty[1].load(std::memory_order_relaxed)) == 0)
+      continue;
+    lock.unlock();
+    // Everything a client wrote since the last pass goes out in one LED batch
+    controller.beginFrame();
+    mergeLEDs();
+    controller.commitFrame();
+    lock.lock();
+  }
+}
+
+std::unique_ptr<SharedEventBusClient> SharedEventBusClient::open(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    std::cerr << "Cannot open shared memory " << name << ": " << std::strerror(errno) << std::endl;
+    return nullptr;
+  }
+  struct stat info {};
+  void *mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= SharedBusLayout::sizeFor(2))
+    mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    std::cerr << "Cannot map shared memory " << name << std::endl;
+    return nullptr;
+  }
+
+  auto *layout = static_cast<SharedBusLayout *>(mapping);
+  auto size = static_cast<std::size_t>(info.st_size);
+  // Read once: any process that can write the segment can change it after this check
+  std::size_t capacity = layout->capacity;
+  bool valid = std::memcmp(layout->magic, MAGIC, sizeof(MAGIC)) == 0 && layout->version == VERSION && capacity >= 2 &&
+               (capacity & (capacity - 1)) == 0 && SharedBusLayout::sizeFor(capacity) <= size;
+  if (!valid) {
+    std::cerr << name << " is not an APC Mini event bus" << std::endl;
+    munmap(mapping, size);
+    return nullptr;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return std::unique_ptr<SharedEventBusClient>(new SharedEventBusClient(layout, size, capacity));
+}
+
+SharedEventBusClient::SharedEventBusClient(SharedBusLayout *mapped, std::size_t size, std::size_t capacity)
+    : layout(mapped), mappedSize(size), ringSize(capacity), cursor(mapped->published.load(std::memory_order_acquire)) {}
+
+SharedEventBusClient::~SharedEventBusClient() { munmap(layout, mappedSize); }
+
+std::size_t SharedEventBusClient::read(APCMiniController::ControllerEvent *out, std::size_t capacity) {
+  std::size_t count = 0;
+  while (count < capacity) {
+    auto head = layout->published.load(std::memory_order_acquire);
+    if (cursor >= head)
+      break;
+    if (head - cursor > ringSize) {
+      lost += head - ringSize - cursor;
+      cursor = head - ringSize;
+    }
+    auto &slot = layout->slots()[cursor & (ringSize - 1)];
+    auto before = slot.sequence.load(std::memory_order_acquire);
+    auto timeNs = slot.timeNs.load(std::memory_order_relaxed);
+    auto payload = slot.payload.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto after = slot.sequence.load(std::memory_order_relaxed);
+    // Being overwritten: the next pass sees the publisher ahead by more than a ring
+    if (before != 2 * cursor + 2 || after != before)
+      continue;
+    out[count++] = unpack(payload, timeNs);
+    cursor++;
+  }
+  return count;
+}
+
+void SharedEventBusClient::setLED(int note, unsigned char value) {
+  if (!LedOutputPipeline::isLedNote(note))
+    return;
+  layout->ledValues[static_cast<std::size_t>(note)].store(value, std::memory_order_relaxed);
+  layout->ledDirty[static_cast<std::size_t>(note / 64)].fetch_or(std::uint64_t{1} << (note % 64), std::memory_order_release);
+}
+
+void SharedEventBusClient::setGrid(const std::array<APCMiniController::LedColor, 64> &colors) {
+  // Grid notes are 0-63, all in the first dirty word, so the merge sees the grid whole
+  for (int index = 0; index < 64; index++) {
+    layout->ledValues[static_cast<std::size_t>(ApcMiniLayout::gridNote(index))].store(static_cast<unsigned char>(colors[static_cast<std::size_t>(index)]),
+                                                                                      std::memory_order_relaxed);
+  }
+  layout->ledDirty[0].fetch_or(~std::uint64_t{0}, std::memory_order_release);
+}
@@ -0,0 +1,59 @@
+#include "thread_policy.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace {
+
+bool applyToHandle(pthread_t handle, const ThreadPolicy &policy, const char *name) {
+  bool applied = true;
+  if (policy.cpu >= 0) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    int error = EINVAL;
+    if (policy.cpu < CPU_SETSIZE) {
+      CPU_SET(policy.cpu, &cpus);
+      error = pthread_setaffinity_np(handle, sizeof(cpus), &cpus);
+    }
+    if (error != 0) {
+      std::cerr << "Cannot pin " << name << " thread to CPU " << policy.cpu << ": " << std::strerror(error) << std::endl;
+      applied = false;
+    }
+#else
+    std::cerr << "Cannot pin " << name << " thread: CPU affinity is not supported on this platform" << std::endl;
+    applied = false;
+#endif
+  }
+  if (policy.priority > 0) {
+    sched_param param{};
+    param.sched_priority = policy.priority;
+    int error = pthread_setschedparam(handle, SCHED_FIFO, &param);
+    if (error != 0) {
+      std::cerr << "Cannot run " << name << " thread at SCHED_FIFO " << policy.priority << ": " << std::strerror(error) << std::endl;
+      applied = false;
+    }
+  }
+  return applied;
+}
+
+} // namespace
+
+bool applyThreadPolicy(std::thread &thread, const ThreadPolicy &policy, const char *name) {
+  return policy.isDefault() || applyToHandle(thread.native_handle(), policy, name);
+}
+
+bool applyThreadPolicy(const ThreadPolicy &policy, const char *name) {
+  return policy.isDefault() || applyToHandle(pthread_self(), policy, name);
+}
+
+bool lockProcessMemory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    std::cerr << "Cannot lock memory: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
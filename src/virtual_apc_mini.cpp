@@ -0,0 +1,112 @@
+#include "virtual_apc_mini.hpp"
+#include <chrono>
+
+bool VirtualApcMini::open() {
+  if (!isAvailable())
+    return false;
+  openFlag.store(true, std::memory_order_release);
+  return true;
+}
+
+void VirtualApcMini::close() { openFlag.store(false, std::memory_order_release); }
+
+void VirtualApcMini::setInputHandler(InputHandler handler, void *userData) {
+  inputHandler = handler;
+  inputUserData = userData;
+}
+
+bool VirtualApcMini::send(const unsigned char *data, std::size_t size) {
+  if (!isOpen() || !isAvailable())
+    return false;
+
+  // Decode the stream like the device would, including running status
+  unsigned char status = 0;
+  unsigned char dataBytes[2] = {0, 0};
+  std::size_t dataCount = 0;
+  std::uint64_t messages = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    unsigned char byte = data[i];
+    if (byte & 0x80) {
+      status = byte;
+      dataCount = 0;
+      continue;
+    }
+    if (status == 0)
+      continue;
+    dataBytes[dataCount++] = byte;
+    if (dataCount < 2)
+      continue;
+    dataCount = 0;
+    messages++;
+    unsigned char type = status & 0xF0;
+    if (type == 0x90)
+      leds[dataBytes[0]].store(dataBytes[1], std::memory_order_relaxed);
+    else if (type == 0x80)
+      leds[dataBytes[0]].store(0, std::memory_order_relaxed);
+  }
+  messagesReceived.fetch_add(messages, std::memory_order_relaxed);
+  bytesReceived.fetch_add(size, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(recordMutex);
+  if (recording)
+    recorded.emplace_back(data, data + size);
+  return true;
+}
+
+void VirtualApcMini::pressButton(int note, double timeStamp) {
+  const unsigned char message[3] = {0x90, static_cast<unsigned char>(note & 0x7F), 0x7F};
+  inject(message, sizeof(message), timeStamp);
+}
+
+void VirtualApcMini::releaseButton(int note, double timeStamp) {
+  const unsigned char message[3] = {0x80, static_cast<unsigned char>(note & 0x7F), 0x7F};
+  inject(message, sizeof(message), timeStamp);
+}
+
+void VirtualApcMini::moveFader(int controlNumber, int value, double timeStamp) {
+  const unsigned char message[3] = {0xB0, static_cast<unsigned char>(controlNumber & 0x7F), static_cast<unsigned char>(value & 0x7F)};
+  inject(message, sizeof(message), timeStamp);
+}
+
+void VirtualApcMini::inject(const unsigned char *data, std::size_t size, double timeStamp) {
+  if (!isOpen() || !isAvailable() || !inputHandler)
+    return;
+  if (timeStamp < 0) {
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    auto last = lastInjectNs.exchange(now, std::memory_order_relaxed);
+    timeStamp = last == 0 ? 0.0 : static_cast<double>(now - last) / 1e9;
+  }
+  inputHandler(timeStamp, data, size, inputUserData);
+}
+
+void VirtualApcMini::unplug() {
+  pluggedIn.store(false, std::memory_order_release);
+  for (auto &led : leds) {
+    led.store(0, std::memory_order_relaxed);
+  }
+}
+
+void VirtualApcMini::plugIn() { pluggedIn.store(true, std::memory_order_release); }
+
+unsigned char VirtualApcMini::ledState(int note) const {
+  if (note < 0 || note > 127)
+    return 0;
+  return leds[static_cast<std::size_t>(note)].load(std::memory_order_relaxed);
+}
+
+void VirtualApcMini::resetCounters() {
+  messagesReceived.store(0, std::memory_order_relaxed);
+  bytesReceived.store(0, std::memory_order_relaxed);
+}
+
+void VirtualApcMini::setRecording(bool enabled) {
+  std::lock_guard<std::mutex> lock(recordMutex);
+  recording = enabled;
+  if (!enabled)
+    recorded.clear();
+}
+
+std::vector<std::vector<unsigned char>> VirtualApcMini::recordedSends() const {
+  std::lock_guard<std::mutex> lock(recordMutex);
+  return recorded;
+}